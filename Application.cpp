@@ -106,8 +106,11 @@ namespace ClassGame {
                     // Handle automated gameplay for Chess
                     if (chessGame && !gameOver) {
                         int currentPlayer = game->getCurrentPlayer()->playerNumber();
+                        // the search runs in the background, this only starts it or picks up its move
                         if ((currentPlayer == 0 && whiteAI) || (currentPlayer == 1 && blackAI)) {
                             chessGame->makeRandomMoveForCurrentPlayer();
+                        } else if (chessGame->aiThinking()) {
+                            chessGame->cancelAIMove();
                         }
                     }
                     
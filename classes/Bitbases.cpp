@@ -0,0 +1,194 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include "Bitbases.h"
+#include "GameState.h"
+
+static constexpr size_t BITBASE_HEADER_SIZE = 64;
+
+// the white king's square folded into the a1-d1-d4 triangle, -1 outside it
+struct TriangleTable {
+    int8_t index[64];
+    constexpr TriangleTable() : index() {
+        int next = 0;
+        for (int square = 0; square < 64; square++) {
+            const int file = square & 7;
+            const int rank = square >> 3;
+            index[square] = (file <= 3 && rank <= file) ? next++ : -1;
+        }
+    }
+};
+static constexpr TriangleTable Triangle;
+
+uint64_t Bitbases::makeKey(const std::string& name) {
+    uint64_t key = 0;
+    for (size_t i = 0; i < name.size() && i < 8; i++) {
+        key |= (uint64_t)(unsigned char)name[i] << (8 * i);
+    }
+    return key;
+}
+
+std::string Bitbases::keyName(uint64_t key) {
+    std::string name;
+    for (; key; key >>= 8) {
+        name += (char)(key & 0xFF);
+    }
+    return name;
+}
+
+bool Bitbases::hasPawns(uint64_t key) {
+    for (; key; key >>= 8) {
+        if ((key & 0xFF) == 'P')
+            return true;
+    }
+    return false;
+}
+
+size_t Bitbases::tableSize(uint64_t key) {
+    size_t size = 2 * (hasPawns(key) ? 32 : 10);
+    // every piece but the white king takes a full 64 squares
+    for (key >>= 8; key; key >>= 8) {
+        size *= 64;
+    }
+    return size;
+}
+
+bool Bitbases::describe(const GameState& state, BitbasePosition& position) {
+    const uint64_t whiteKing = state._bitboards[WHITE_KING].getData();
+    const uint64_t blackKing = state._bitboards[BLACK_KING].getData();
+    if (BitBoard(state._bitboards[OCCUPANCY]).countBits() > BITBASE_MAX_PIECES || !whiteKing || !blackKing)
+        return false;
+
+    // each side's other pieces from the strongest down, by bitboard index within the color
+    int pieces[2][BITBASE_MAX_PIECES];
+    int squares[2][BITBASE_MAX_PIECES];
+    int counts[2] = { 0, 0 };
+    for (int side = 0; side < 2; side++) {
+        const int offset = side ? BLACK_PAWNS : WHITE_PAWNS;
+        for (int piece = WHITE_QUEENS; piece >= WHITE_PAWNS; piece--) {
+            state._bitboards[piece + offset].forEachBit([&](int square) {
+                pieces[side][counts[side]] = piece;
+                squares[side][counts[side]++] = square;
+            });
+        }
+    }
+    // the side with more pieces, or the stronger ones on a tie, is looked up as white
+    bool swap = counts[1] > counts[0];
+    if (counts[1] == counts[0]) {
+        for (int i = 0; i < counts[0]; i++) {
+            if (pieces[0][i] != pieces[1][i]) {
+                swap = pieces[1][i] > pieces[0][i];
+                break;
+            }
+        }
+    }
+
+    const int strong = swap ? 1 : 0;
+    const int flip = swap ? 56 : 0;
+    std::string name = "K";
+    position.count = 2;
+    position.piece[0] = WHITE_KING;
+    position.square[0] = BitBoard(swap ? blackKing : whiteKing).firstBit() ^ flip;
+    position.piece[1] = BLACK_KING;
+    position.square[1] = BitBoard(swap ? whiteKing : blackKing).firstBit() ^ flip;
+    for (int side = 0; side < 2; side++) {
+        const int from = side ? 1 - strong : strong;
+        if (side == 1)
+            name += 'K';
+        for (int i = 0; i < counts[from]; i++) {
+            name += "PNBRQ"[pieces[from][i]];
+            position.piece[position.count] = pieces[from][i] + (side ? BLACK_PAWNS : WHITE_PAWNS);
+            position.square[position.count++] = squares[from][i] ^ flip;
+        }
+    }
+    position.key = makeKey(name);
+    position.sideToMove = ((state.color == WHITE) != swap) ? 0 : 1;
+    return true;
+}
+
+// one of the eight symmetries of the board: bit 2 swaps files and ranks, bit 0 mirrors the files and bit 1 the ranks
+static inline int transformSquare(int square, int symmetry) {
+    if (symmetry & 4)
+        square = ((square & 7) << 3) | (square >> 3);
+    if (symmetry & 1)
+        square ^= 7;
+    if (symmetry & 2)
+        square ^= 56;
+    return square;
+}
+
+size_t Bitbases::index(const BitbasePosition& position) {
+    const bool pawns = hasPawns(position.key);
+    // left to right is always a symmetry, the other ones only hold without pawns
+    // every symmetry that puts the white king in its corner is tried and the smallest index wins,
+    // which settles kings on the diagonal and identical pieces listed in either order
+    size_t best = SIZE_MAX;
+    for (int symmetry = 0; symmetry < (pawns ? 2 : 8); symmetry++) {
+        int squares[BITBASE_MAX_PIECES];
+        for (int i = 0; i < position.count; i++) {
+            squares[i] = transformSquare(position.square[i], symmetry);
+        }
+        if (pawns ? (squares[0] & 7) > 3 : Triangle.index[squares[0]] < 0)
+            continue;
+        for (int i = 3; i < position.count; i++) {
+            for (int j = i; j > 2 && position.piece[j - 1] == position.piece[j] && squares[j - 1] > squares[j]; j--) {
+                std::swap(squares[j - 1], squares[j]);
+            }
+        }
+
+        size_t index = position.sideToMove;
+        index = pawns ? index * 32 + (squares[0] >> 3) * 4 + (squares[0] & 7) : index * 10 + Triangle.index[squares[0]];
+        for (int i = 1; i < position.count; i++) {
+            index = index * 64 + squares[i];
+        }
+        best = std::min(best, index);
+    }
+    return best;
+}
+
+bool Bitbases::load(const std::string& path) {
+    unload();
+    if (!_file.open(path))
+        return false;
+    const unsigned char* data = _file.data();
+    uint32_t count = 0;
+    if (_file.size() >= BITBASE_HEADER_SIZE) {
+        std::memcpy(&count, data + 8, sizeof(count));
+    }
+    if (_file.size() < BITBASE_HEADER_SIZE + (size_t)count * 16 || std::memcmp(data, "CHESSBB1", 8) != 0) {
+        unload();
+        return false;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        uint64_t entry[2];
+        std::memcpy(entry, data + BITBASE_HEADER_SIZE + i * 16, sizeof(entry));
+        if (entry[1] + (tableSize(entry[0]) + 3) / 4 > _file.size()) {
+            unload();
+            return false;
+        }
+        _tables[entry[0]] = data + entry[1];
+    }
+    return true;
+}
+
+void Bitbases::unload() {
+    _tables.clear();
+    _file.close();
+}
+
+bool Bitbases::probe(const GameState& state, BitbaseResult& result) const {
+    BitbasePosition position;
+    if (state.castlingRights != 0 || state.enPassantSquare >= 0 || !describe(state, position))
+        return false;
+    // two bare kings need no table
+    if (position.count == 2) {
+        result = BitbaseDraw;
+        return true;
+    }
+    auto table = _tables.find(position.key);
+    if (table == _tables.end())
+        return false;
+    const size_t index = Bitbases::index(position);
+    result = (BitbaseResult)((table->second[index >> 2] >> ((index & 3) * 2)) & 3);
+    return result != BitbaseInvalid;
+}
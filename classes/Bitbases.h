@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include "MappedFile.h"
+
+class GameState;
+
+// result for the side to move, as stored in the file two bits per position
+enum BitbaseResult {
+    BitbaseDraw = 0,
+    BitbaseWin = 1,
+    BitbaseLoss = 2,
+    BitbaseInvalid = 3      // can't happen in a game, such as the side not to move being in check
+};
+
+constexpr int BITBASE_MAX_PIECES = 4;
+
+//
+// a position the way the tables see it: the material key names the stronger side's pieces first as white
+// ("KRKP" is king and rook against king and pawn), colors are swapped to get there,
+// the kings come first in the piece list and then the pieces in key order
+//
+struct BitbasePosition {
+    uint64_t key;           // the key's letters packed into a number, see makeKey
+    int count;
+    int piece[BITBASE_MAX_PIECES];    // bitboard index
+    int square[BITBASE_MAX_PIECES];
+    int sideToMove;         // 0 white, 1 black
+};
+
+//
+// win/draw/loss tables for endgames with up to four pieces, written by bitbasegen
+// the file is mapped and probed in place, a lookup is the material key, one hash lookup and a shift
+//
+// file layout, little endian: "CHESSBB1", int32 table count, zero padded to 64 bytes,
+// then per table the uint64 key and the uint64 offset of its data, then the data, four positions per byte
+// positions are indexed by side to move, the white king folded into a1-d1-d4 (a-d files with pawns on the board)
+// and the other pieces' squares, see index()
+//
+class Bitbases {
+public:
+    // false if the file is missing or isn't a bitbase file, the old tables are dropped either way
+    bool load(const std::string& path);
+    void unload();
+    bool isLoaded() const { return _file.isOpen(); }
+    int tableCount() const { return (int)_tables.size(); }
+
+    // false when the position has more pieces than the tables, castling rights or en passant, or no table was loaded for it
+    bool probe(const GameState& state, BitbaseResult& result) const;
+
+    // the parts bitbasegen shares with probing
+    static uint64_t makeKey(const std::string& name);
+    static std::string keyName(uint64_t key);
+    static bool hasPawns(uint64_t key);
+    // positions in the table, including the invalid ones
+    static size_t tableSize(uint64_t key);
+    // false with more than BITBASE_MAX_PIECES pieces on the board
+    static bool describe(const GameState& state, BitbasePosition& position);
+    // folds the board by its symmetries, so every mirror image of a position lands on the same index
+    static size_t index(const BitbasePosition& position);
+
+private:
+    MappedFile _file;
+    std::unordered_map<uint64_t, const uint8_t*> _tables;
+};
@@ -78,6 +78,14 @@ class BitBoard {
     const int firstBit() const {
         return bitScanForward(_data);
     }
+
+    const int countBits() const {
+#if defined(_MSC_VER) && !defined(__clang__)
+        return (int)__popcnt64(_data);
+#else
+        return __builtin_popcountll(_data);
+#endif
+    }
     
     // Method to loop through each bit in the element and perform an operation on it.
     template <typename Func>
@@ -5,12 +5,20 @@
 #include <iostream>
 #include <algorithm>
 #include <cstring>
+#include <thread>
 
 Chess::Chess() {
     m_grid = new Grid(8, 8);
+    _gameOptions.AIMAXDepth = AI_MAX_DEPTH;
+    _gameOptions.AITimeLimitMS = AI_TIME_LIMIT_MS;
+    _gameOptions.AIThreads = std::max(1, (int)std::thread::hardware_concurrency());
+    m_ai.loadNetwork(AI_NETWORK_FILE);
+    m_ai.loadBitbases(AI_BITBASE_FILE);
+    m_ai.loadBook(AI_BOOK_FILE);
 }
 
 Chess::~Chess() {
+    cancelAIMove();
     delete m_grid;
 }
 
@@ -27,6 +35,7 @@ void Chess::setUpBoard()
 }
 
 void Chess::stopGame() {
+    cancelAIMove();
     m_grid->forEachSquare([](ChessSquare* square, int x, int y) {
         square->destroyBit();
     });
@@ -118,6 +127,16 @@ void Chess::FENToBoard(const std::string& fen) {
         
         file++;
     }
+    m_halfmoveClock = 0;
+    m_pieceCount = countPieces();
+}
+
+int Chess::countPieces() {
+    int count = 0;
+    m_grid->forEachSquare([&](ChessSquare* square, int x, int y) {
+        if (square->bit()) count++;
+    });
+    return count;
 }
 
 std::string Chess::initialStateString() {
@@ -150,6 +169,8 @@ bool Chess::actionForEmptyHolder(BitHolder &holder) {
 }
 
 bool Chess::canBitMoveFrom(Bit &bit, BitHolder &start) {
+    // the AI is thinking about this board, nothing may move under it
+    if (aiThinking()) return false;
     int currentPlayer = getCurrentPlayer()->playerNumber();
     int pieceColor = bit.gameTag() & 128;
     if (currentPlayer == 0 && pieceColor == 0) return true;
@@ -315,6 +336,10 @@ void Chess::bitMovedFromTo(Bit &bit, BitHolder &start, BitHolder &end) {
     m_enPassantC = nextEnPassantCol;
     m_enPassantR = nextEnPassantRow;
     m_enPassantR2 = nextEnPassantTargetRow;
+    // the captured piece is already off the board here, en passant included
+    const int pieceCount = countPieces();
+    m_halfmoveClock = (pieceType == Pawn || pieceCount < m_pieceCount) ? 0 : m_halfmoveClock + 1;
+    m_pieceCount = pieceCount;
     if (pieceType == King) {
         if (isWhite) {
             m_whiteKingMoved = true;
@@ -371,15 +396,16 @@ void Chess::bitMovedFromTo(Bit &bit, BitHolder &start, BitHolder &end) {
                 } else {
                     newTag = 128;
                 }
-                newTag += Queen;
+                newTag += m_promotionPiece;
                 bit.setGameTag(newTag);
+                const char* pieces[] = { "pawn.png", "knight.png", "bishop.png", "rook.png", "queen.png", "king.png" };
                 std::string spritePath;
                 if (isWhite) {
                     spritePath = "w_";
                 } else {
                     spritePath = "b_";
                 }
-                spritePath += std::string("queen.png");
+                spritePath += std::string(pieces[m_promotionPiece - 1]);
                 bit.LoadTextureFromFile(spritePath.c_str());
                 bit.setSize(pieceSize, pieceSize);
             }
@@ -798,112 +824,72 @@ std::vector<ChessMove> Chess::generateKingMoves(int x, int y, Bit* piece) {
     return moves;
 }
 
-int Chess::evaluateBoard(int playerNumber) {
-    static const int PIECE_VALUES[] = {0, 100, 310, 330, 500, 900, 20000};
-    int score = 0;
-    m_grid->forEachSquare([&](ChessSquare* square, int x, int y) {
-        Bit* piece = square->bit();
-        if (!piece) return;
-        int pieceType = piece->gameTag() & 0x7F;
-        bool isWhite = (piece->gameTag() & 0x80) == 0;
-        int pieceValue = PIECE_VALUES[pieceType];
-        bool isPlayerPiece = (isWhite && playerNumber == 0) || (!isWhite && playerNumber == 1);
-        score += isPlayerPiece ? pieceValue : -pieceValue;
-    });
-    return score;
-}
-
-void Chess::makeMove(const ChessMove& move) {
-    if (move.toSquare->bit()) {
-        move.toSquare->releaseBit();
-    }
-    move.fromSquare->releaseBit();
-    move.toSquare->setBit(move.piece);
-}
-
-void Chess::unmakeMove(const ChessMove& move, Bit* capturedPiece, int oldEnPassantCol, int oldEnPassantRow, int oldEnPassantTarget) {
-    move.toSquare->releaseBit();
-    move.fromSquare->setBit(move.piece);
-    move.toSquare->setBit(capturedPiece);
-    m_enPassantC = oldEnPassantCol;
-    m_enPassantR = oldEnPassantRow;
-    m_enPassantR2 = oldEnPassantTarget;
-}
-
-int Chess::negamax(int depth, int alpha, int beta, int playerNumber) {
-    if (depth == 0) {
-        return evaluateBoard(playerNumber);
-    }
-    std::vector<ChessMove> moves = generateAllMoves(playerNumber);
-    if (moves.empty()) {
-        if (isInCheck(playerNumber)) {
-            return -50000;
-        }
-        return 0;
+// snapshot the board into a GameState once and let the bitboard search work on that
+GameState Chess::snapshotState(int playerNumber) {
+    GameState state;
+    int castling = 0;
+    if (m_castlingRights[0]) castling |= WhiteKingSide;
+    if (m_castlingRights[1]) castling |= WhiteQueenSide;
+    if (m_castlingRights[2]) castling |= BlackKingSide;
+    if (m_castlingRights[3]) castling |= BlackQueenSide;
+    const int enPassant = (m_enPassantC != -1) ? m_enPassantR2 * 8 + m_enPassantC : -1;
+    state.init(stateString().c_str(), playerNumber == 0 ? WHITE : BLACK, castling, enPassant, m_halfmoveClock);
+    return state;
+}
+
+// the search gets its own copy of the position, so the frame thread keeps drawing the Grid while it runs
+void Chess::updateAIMove(int playerNumber) {
+    if (!m_aiSearch.valid()) {
+        // the time option is the hard cap, no new iteration is started past half of it
+        // the thread pool is only rebuilt when the option actually changes
+        m_ai.setThreads(_gameOptions.AIThreads);
+        SearchLimits limits;
+        limits.maxDepth = _gameOptions.AIMAXDepth;
+        limits.hardTimeMs = _gameOptions.AITimeLimitMS;
+        limits.softTimeMs = _gameOptions.AITimeLimitMS / 2;
+        limits.maxNodes = _gameOptions.AIMAXNodes;
+        m_aiSearchBoard = stateString();
+        m_aiSearchPlayer = playerNumber;
+        m_ai.prepareSearch();
+        m_aiSearch = std::async(std::launch::async, [this, state = snapshotState(playerNumber), limits]() mutable {
+            return m_ai.findBestMove(state, limits);
+        });
+        return;
     }
-    std::sort(moves.begin(), moves.end(), [](const ChessMove& a, const ChessMove& b) {
-        return (a.toSquare->bit() != nullptr) > (b.toSquare->bit() != nullptr);
-    });
-    int maxScore = INT_MIN;
-    int opponentPlayer = 1 - playerNumber;
-    for (const auto& move : moves) {
-        Bit* capturedPiece = move.toSquare->bit();
-        int oldEnPassantCol = m_enPassantC;
-        int oldEnPassantRow = m_enPassantR;
-        int oldEnPassantTarget = m_enPassantR2;
-        makeMove(move);
-        int score = -negamax(depth - 1, -beta, -alpha, opponentPlayer);
-        unmakeMove(move, capturedPiece, oldEnPassantCol, oldEnPassantRow, oldEnPassantTarget);
-        maxScore = std::max(maxScore, score);
-        alpha = std::max(alpha, score);
-        if (alpha >= beta) {
-            break;
-        }
-    }
-    return maxScore;
-}
-
-ChessMove Chess::findBestMove(int playerNumber) {
-    std::vector<ChessMove> moves = generateAllMoves(playerNumber);
-    if (moves.empty()) {
-        return ChessMove(0, 0, 0, 0, nullptr, nullptr, nullptr);
+    if (m_aiSearch.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        return;
     }
-    std::sort(moves.begin(), moves.end(), [](const ChessMove& a, const ChessMove& b) {
-        return (a.toSquare->bit() != nullptr) > (b.toSquare->bit() != nullptr);
-    });
-    
-    ChessMove bestMove = moves[0];
-    int bestScore = INT_MIN;
-    int opponentPlayer = 1 - playerNumber;
-    
-    for (const auto& move : moves) {
-        Bit* capturedPiece = move.toSquare->bit();
-        int oldEnPassantCol = m_enPassantC;
-        int oldEnPassantRow = m_enPassantR;
-        int oldEnPassantTarget = m_enPassantR2;
-        
-        makeMove(move);
-        int score = -negamax(3, INT_MIN, INT_MAX, opponentPlayer);
-        unmakeMove(move, capturedPiece, oldEnPassantCol, oldEnPassantRow, oldEnPassantTarget);
-        
-        if (score > bestScore) {
-            bestScore = score;
-            bestMove = move;
-        }
+    const BitMove bestMove = m_aiSearch.get();
+    _gameOptions.AIDepthSearches = m_ai.lastResult().depth;
+    if (playerNumber == m_aiSearchPlayer && stateString() == m_aiSearchBoard) {
+        applyAIMove(bestMove);
     }
-    return bestMove;
 }
 
-void Chess::AIMove(int playerNumber) {
-    ChessMove bestMove = findBestMove(playerNumber);
-    if (bestMove.fromSquare && bestMove.toSquare && bestMove.piece) {
-        if (bestMove.toSquare->bit()) {
-            bestMove.toSquare->destroyBit();
-        }
-        bestMove.toSquare->setBit(bestMove.piece);
-        bestMove.fromSquare->setBit(nullptr);
-        bestMove.piece->setPosition(bestMove.toSquare->getPosition());
-        endTurn();
+void Chess::cancelAIMove() {
+    if (!m_aiSearch.valid()) {
+        return;
     }
+    m_ai.stop();
+    m_aiSearch.get();
 }
 
+void Chess::applyAIMove(const BitMove& bestMove) {
+    ChessSquare* fromSquare = m_grid->getSquareByIndex(bestMove.from());
+    ChessSquare* toSquare = m_grid->getSquareByIndex(bestMove.to());
+    // an empty move means there was nothing legal to play
+    if (!fromSquare || !toSquare || !fromSquare->bit() || bestMove == BitMove()) {
+        return;
+    }
+    Bit* piece = fromSquare->bit();
+    if (toSquare->bit()) {
+        toSquare->destroyBit();
+    }
+    fromSquare->releaseBit();
+    toSquare->setBit(piece);
+    piece->setPosition(toSquare->getPosition());
+    // let the regular move handler deal with castling, en passant, promotion and ending the turn
+    m_promotionPiece = bestMove.isPromotion() ? bestMove.promotionPiece() : Queen;
+    bitMovedFromTo(*piece, *fromSquare, *toSquare);
+    m_promotionPiece = Queen;
+}
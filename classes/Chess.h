@@ -2,21 +2,24 @@
 
 #include "Game.h"
 #include "Grid.h"
+#include "Bitboard.h"
+#include "ChessAI.h"
 #include <vector>
 #include <unordered_map>
 #include <cstdint>
+#include <future>
+#include <string>
 
 constexpr int pieceSize = 80;
-
-enum ChessPiece {
-    NoPiece = 0,
-    Pawn,
-    Knight,
-    Bishop,
-    Rook,
-    Queen,
-    King
-};
+// default AI budget, the search deepens until one of these runs out
+constexpr int AI_MAX_DEPTH = 16;
+constexpr int AI_TIME_LIMIT_MS = 2000;
+// evaluation network picked up from the resources when it's there, the AI falls back to piece-square tables without it
+constexpr const char* AI_NETWORK_FILE = "resources/chess.nnue";
+// endgame tables written by bitbasegen, searched without them when the file isn't there
+constexpr const char* AI_BITBASE_FILE = "resources/chess.bitbases";
+// opening book written by bookgen, the AI searches from the first move without it
+constexpr const char* AI_BOOK_FILE = "resources/book.bin";
 
 struct ChessMove {
     int fromX, fromY, toX, toY;
@@ -52,9 +55,14 @@ public:
 
     Grid* getGrid() override { return m_grid; }
 
+    // called every frame while the AI is on move: the first call starts a search on a snapshot of the board
+    // in the background, later ones return right away until the move is ready and then play it
     void makeRandomMoveForCurrentPlayer() { 
-        AIMove(getCurrentPlayer()->playerNumber()); 
+        updateAIMove(getCurrentPlayer()->playerNumber()); 
     }
+    bool aiThinking() const { return m_aiSearch.valid(); }
+    // stops a running search and waits for it to return, its move is dropped
+    void cancelAIMove();
 
 private:
     Grid* m_grid;
@@ -70,11 +78,18 @@ private:
     int m_enPassantC = -1;
     int m_enPassantR = -1;
     int m_enPassantR2 = -1;
+    // plies since the last capture or pawn move, the search needs it for the fifty move rule
+    int m_halfmoveClock = 0;
+    // pieces on the board after the last move, a move that leaves fewer was a capture
+    int m_pieceCount = 0;
+    // what a pawn reaching the last rank turns into, the AI can pick an under-promotion
+    ChessPiece m_promotionPiece = Queen;
 
     Bit* PieceForPlayer(const int playerNumber, ChessPiece piece);
     char pieceNotation(int x, int y) const;
 
     void FENToBoard(const std::string& fen);
+    int countPieces();
 
     std::vector<ChessMove> generateAllMoves(int playerNumber);
     std::vector<ChessMove> generatePawnMoves(int x, int y, Bit* piece);
@@ -90,10 +105,14 @@ private:
     bool checkAfterMove(int fromX, int fromY, int toX, int toY, int playerNumber);
     bool isInCheck(int playerNumber);
 
-    int evaluateBoard(int playerNumber);
-    int negamax(int depth, int alpha, int beta, int playerNumber);
-    ChessMove findBestMove(int playerNumber);
-    void makeMove(const ChessMove& move);
-    void unmakeMove(const ChessMove& move, Bit* capturedPiece, int oldEnPassantCol, int oldEnPassantRow, int oldEnPassantTarget);
-    void AIMove(int playerNumber);
+    // the board as the bitboard search sees it
+    GameState snapshotState(int playerNumber);
+    void updateAIMove(int playerNumber);
+    void applyAIMove(const BitMove& bestMove);
+
+    ChessAI m_ai;
+    // the background search and the board it started from, a result for any other board is dropped
+    std::future<BitMove> m_aiSearch;
+    std::string m_aiSearchBoard;
+    int m_aiSearchPlayer = -1;
 };
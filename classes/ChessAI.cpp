@@ -0,0 +1,638 @@
+#include <algorithm>
+#include <string>
+#include <cstring>
+#include "ChessAI.h"
+#include "MagicBitboards.h"
+
+// piece values indexed by the mailbox character, white positive and black negative
+struct PieceValueTable {
+    int value[128];
+    constexpr PieceValueTable() : value() {
+        value['P'] = 100;   value['p'] = -100;
+        value['N'] = 310;   value['n'] = -310;
+        value['B'] = 330;   value['b'] = -330;
+        value['R'] = 500;   value['r'] = -500;
+        value['Q'] = 900;   value['q'] = -900;
+        value['K'] = 20000; value['k'] = -20000;
+    }
+};
+inline constexpr PieceValueTable PieceValues;
+
+// mate scores go into the table as distance from the stored node so they stay valid at any ply
+static int scoreToTT(int score, int ply) {
+    if (score > MATE_BOUND) return score + ply;
+    if (score < -MATE_BOUND) return score - ply;
+    return score;
+}
+
+static int scoreFromTT(int score, int ply) {
+    if (score > MATE_BOUND) return score - ply;
+    if (score < -MATE_BOUND) return score + ply;
+    return score;
+}
+
+// material a capture or promotion wins before any recapture
+static int captureGain(const GameState& state, const BitMove& move) {
+    int gain = (move.type() == EnPassant) ? 100 : std::abs(PieceValues.value[(unsigned char)state.state[move.to()]]);
+    if (move.isPromotion()) {
+        gain += std::abs(PieceValues.value[(unsigned char)"NBRQ"[move.type() & 3]]) - 100;
+    }
+    return gain;
+}
+
+// move ordering bands, history scores stay below HISTORY_MAX so they always sort after the other quiet moves
+constexpr int PV_MOVE_SCORE = 1 << 22;
+constexpr int HASH_MOVE_SCORE = 1 << 21;
+constexpr int CAPTURE_SCORE = 1 << 20;
+constexpr int KILLER_SCORE = 1 << 19;       // first killer, the second one scores one less
+constexpr int COUNTER_MOVE_SCORE = KILLER_SCORE - 2;
+constexpr int HISTORY_MAX = 1 << 16;
+// safety margin on top of the captured piece for delta pruning in the quiescence search
+constexpr int DELTA_MARGIN = 200;
+
+// midgame bonus for each pawn in front of the king, one and two ranks ahead
+constexpr int SHIELD_PAWN[2] = { makeScore(12, 0), makeScore(6, 0) };
+// endgame bonus for a passed pawn whose next square is empty, by rank counted from its own side
+constexpr int FREE_PASSER[8] = {
+    makeScore(0, 0), makeScore(0, 0), makeScore(0, 5), makeScore(0, 10),
+    makeScore(0, 20), makeScore(0, 35), makeScore(0, 60), makeScore(0, 0)
+};
+
+// per square a piece type reaches that isn't taken by its own side or covered by an enemy pawn, by bitboard index
+constexpr int MOBILITY[6] = { 0, makeScore(4, 4), makeScore(5, 5), makeScore(2, 4), makeScore(1, 2), 0 };
+// how much one square of the king zone (the king and the squares around it) hit by each piece type counts
+constexpr int KING_ZONE_WEIGHT[6] = { 0, 2, 2, 3, 5, 0 };
+constexpr int KING_ZONE_ATTACK = makeScore(-4, 0);
+// a piece other than a pawn or the king that is attacked and not defended
+constexpr int HANGING_PIECE = makeScore(-25, -30);
+
+// mobility, attacks on the enemy king zone and hanging pieces from one side's point of view, off the attack maps
+static int attackTerms(const GameState& state, int color) {
+    const int offset = color == 0 ? WHITE_PAWNS : BLACK_PAWNS;
+    const int enemyOffset = color == 0 ? BLACK_PAWNS : WHITE_PAWNS;
+    const uint64_t own = state._bitboards[WHITE_ALL_PIECES + offset].getData();
+    const uint64_t available = ~own & ~state._attacks[WHITE_PAWNS + enemyOffset].getData();
+    const uint64_t enemyKing = state._bitboards[WHITE_KING + enemyOffset].getData();
+    const uint64_t kingZone = enemyKing ? (KingAttacks[BitBoard(enemyKing).firstBit()] | enemyKing) : 0;
+
+    int score = 0;
+    int kingZoneUnits = 0;
+    for (int piece = WHITE_KNIGHTS; piece <= WHITE_QUEENS; piece++) {
+        const uint64_t attacks = state._attacks[piece + offset].getData();
+        score += MOBILITY[piece] * BitBoard(attacks & available).countBits();
+        kingZoneUnits += KING_ZONE_WEIGHT[piece] * BitBoard(attacks & kingZone).countBits();
+    }
+    score += KING_ZONE_ATTACK * kingZoneUnits;
+
+    const uint64_t pieces = own & ~state._bitboards[WHITE_PAWNS + offset].getData() & ~state._bitboards[WHITE_KING + offset].getData();
+    const uint64_t hanging = pieces & state._attacks[WHITE_ALL_PIECES + enemyOffset].getData() & ~state._attacks[WHITE_ALL_PIECES + offset].getData();
+    score += HANGING_PIECE * BitBoard(hanging).countBits();
+    return score;
+}
+
+// the king and passed pawn terms that depend on more than the pawns, from one side's point of view
+static int pawnExtras(const GameState& state, const PawnEntry& pawns, int color) {
+    const uint64_t own = state._bitboards[color == 0 ? WHITE_PAWNS : BLACK_PAWNS].getData();
+    const BitBoard& king = state._bitboards[color == 0 ? WHITE_KING : BLACK_KING];
+    int score = 0;
+    if (king.getData()) {
+        const int kingSquare = king.firstBit();
+        score += SHIELD_PAWN[0] * BitBoard(own & PawnMasks.shield[color][kingSquare][0]).countBits();
+        score += SHIELD_PAWN[1] * BitBoard(own & PawnMasks.shield[color][kingSquare][1]).countBits();
+    }
+    const uint64_t empty = state._bitboards[EMPTY_SQUARES].getData();
+    BitBoard(pawns.passed[color]).forEachBit([&](int square) {
+        const int stop = color == 0 ? square + 8 : square - 8;
+        if (stop >= 0 && stop < 64 && (empty & (1ULL << stop))) {
+            score += FREE_PASSER[color == 0 ? square >> 3 : 7 - (square >> 3)];
+        }
+    });
+    return score;
+}
+
+// how often threads check the clock and publish their node counts
+constexpr uint64_t CHECK_INTERVAL = 2048;
+
+// helper threads skip some depths so they don't all search the same iteration at once
+static const int _skipSize[] = { 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4 };
+static const int _skipPhase[] = { 0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7 };
+
+ChessAI::ChessAI() : _bookSeed((uint64_t)std::chrono::steady_clock::now().time_since_epoch().count()), _stop(false), _generation(0), _stopTarget(0), _prepared(false), _sharedNodes(0) {
+    _tt.resize(DEFAULT_HASH_MB);
+    setThreads(1);
+}
+
+ChessAI::~ChessAI() {
+    _pool.reset();
+}
+
+void ChessAI::setThreads(int threads) {
+    threads = std::max(threads, 1);
+    if (threads == (int)_workers.size())
+        return;
+    _pool.reset();
+    _workers.clear();
+    for (int i = 0; i < threads; i++) {
+        _workers.push_back(std::make_unique<SearchWorker>());
+        _workers.back()->id = i;
+    }
+    if (threads > 1) {
+        _pool = std::make_unique<ThreadPool>(threads - 1);
+    }
+}
+
+void ChessAI::prepareSearch() {
+    _generation++;
+    _prepared = true;
+}
+
+void ChessAI::stop() {
+    _stopTarget = _generation.load();
+    _stop = true;
+}
+
+BitMove ChessAI::findBestMove(GameState& state, int depth) {
+    SearchLimits limits;
+    limits.maxDepth = depth;
+    return findBestMove(state, limits);
+}
+
+BitMove ChessAI::findBestMove(GameState& state, const SearchLimits& limits) {
+    // the flag is cleared before the generation is checked, so a stop() for this search can't be lost in between
+    const uint64_t generation = _prepared.exchange(false) ? _generation.load() : ++_generation;
+    _stop = false;
+    if (_stopTarget.load() == generation) {
+        _stop = true;
+    }
+    _sharedNodes = 0;
+    _limits = limits;
+    if (_limits.maxDepth <= 0 || _limits.maxDepth > MAX_SEARCH_DEPTH) {
+        _limits.maxDepth = MAX_SEARCH_DEPTH;
+    }
+    _startTime = std::chrono::steady_clock::now();
+    _result = SearchResult();
+    _tt.newSearch();
+
+    state.generateAllMoves(_rootMoves);
+    if (_rootMoves.empty()) {
+        return BitMove();
+    }
+    // a book move costs no search time at all
+    if (_book.isLoaded()) {
+        const BitMove bookMove = _book.probe(state, ZobristKeyTable::splitmix64(_bookSeed));
+        if (bookMove != BitMove()) {
+            _result.bestMove = bookMove;
+            _result.timeMs = elapsedMs();
+            return bookMove;
+        }
+    }
+    filterRootMoves(state, _rootMoves);
+
+    for (auto& worker : _workers) {
+        worker->state = state;
+        worker->state.attachNetwork(&_network);
+        worker->state.attachBitbases(_probeBitbases ? &_bitbases : nullptr);
+        worker->nodes = 0;
+        worker->prevPvLength = 0;
+        worker->completedDepth = 0;
+        worker->bestMove = _rootMoves[0];
+        std::memset(worker->history, 0, sizeof(worker->history));
+        for (auto& killers : worker->killers) {
+            killers[0] = killers[1] = BitMove();
+        }
+        for (auto& counters : worker->counterMoves) {
+            for (auto& counter : counters) {
+                counter = BitMove();
+            }
+        }
+    }
+    if (_pool) {
+        _pool->run([this](int index) { iterate(*_workers[index + 1]); });
+    }
+    iterate(*_workers[0]);
+    // the main thread decides when the search is over, the helpers just follow
+    _stop = true;
+    if (_pool) {
+        _pool->wait();
+    }
+
+    const SearchWorker& main = *_workers[0];
+    _result.bestMove = main.bestMove;
+    _result.score = main.score;
+    _result.depth = main.completedDepth;
+    for (const auto& worker : _workers) {
+        _result.nodes += worker->nodes;
+    }
+    _result.timeMs = elapsedMs();
+    return _result.bestMove;
+}
+
+// the search only ever sees a win or a draw from the tables, never a mate, so it can't tell which
+// won position is closer to the end: probing inside an endgame that's already in the tables would leave
+// it shuffling, so there the root moves that keep the result are searched normally instead
+void ChessAI::filterRootMoves(GameState& state, MoveList& moves) {
+    state.attachBitbases(&_bitbases);
+    BitbaseResult rootResult;
+    const bool inTables = state.probeBitbases(rootResult);
+    _probeBitbases = _bitbases.isLoaded() && !inTables;
+    if (inTables) {
+        // the best any move reaches, the opponent losing is a win for us
+        int rank[MAX_MOVES];
+        int best = -1;
+        for (int i = 0; i < moves.size(); i++) {
+            BitbaseResult result;
+            state.pushMove(moves[i]);
+            rank[i] = !state.probeBitbases(result) ? -1 : (result == BitbaseLoss ? 2 : (result == BitbaseDraw ? 1 : 0));
+            state.popMove();
+            best = std::max(best, rank[i]);
+        }
+        int kept = 0;
+        for (int i = 0; i < moves.size(); i++) {
+            if (rank[i] == best) {
+                moves[kept++] = moves[i];
+            }
+        }
+        moves.count = kept;
+    }
+    state.attachBitbases(nullptr);
+}
+
+void ChessAI::iterate(SearchWorker& worker) {
+    MoveList moves = _rootMoves;
+
+    const bool mainThread = (worker.id == 0);
+    int stableIterations = 0;
+    for (int depth = 1; depth <= _limits.maxDepth; depth++) {
+        if (!mainThread) {
+            const int i = (worker.id - 1) % 20;
+            if (((depth + _skipPhase[i]) / _skipSize[i]) % 2) {
+                continue;
+            }
+        }
+        int score = searchRoot(worker, moves, depth);
+        // an unfinished iteration can't be trusted, keep the last complete one
+        if (_stop.load(std::memory_order_relaxed)) {
+            break;
+        }
+        stableIterations = (worker.completedDepth > 0 && worker.pv[0][0] == worker.bestMove) ? stableIterations + 1 : 0;
+        worker.bestMove = worker.pv[0][0];
+        worker.score = score;
+        worker.completedDepth = depth;
+        worker.prevPvLength = worker.pvLength[0];
+        for (int i = 0; i < worker.prevPvLength; i++) {
+            worker.prevPv[i] = worker.pv[0][i];
+        }
+        if (!mainThread) {
+            continue;
+        }
+
+        const int elapsed = elapsedMs();
+        const uint64_t nodes = _sharedNodes.load(std::memory_order_relaxed) + worker.nodes % CHECK_INTERVAL;
+        auto micros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - _startTime).count();
+        uint64_t nps = micros > 0 ? (nodes * 1000000ULL) / micros : nodes;
+        if (_infoCallback) {
+            _infoCallback(SearchInfo{ depth, score, nodes, elapsed, nps, worker.prevPv, worker.prevPvLength });
+        }
+
+        // a forced mate won't get any better by searching deeper
+        if (score > MATE_BOUND || score < -MATE_BOUND) {
+            break;
+        }
+        // spend less of the soft budget when the best move keeps coming back, more when it just changed
+        if (_limits.softTimeMs > 0) {
+            const double scale = stableIterations >= 3 ? 0.5 : (stableIterations == 0 && depth > 1 ? 1.5 : 1.0);
+            if (elapsed >= _limits.softTimeMs * scale) {
+                break;
+            }
+        }
+    }
+}
+
+int ChessAI::searchRoot(SearchWorker& worker, MoveList& moves, int depth) {
+    GameState& state = worker.state;
+    TTData ttData;
+    BitMove hashMove;
+    if (_tt.probe(state._zobristHash, ttData)) {
+        hashMove = ttData.move;
+    }
+    const BitMove pvMove = worker.prevPvLength > 0 ? worker.prevPv[0] : BitMove();
+    orderMoves(worker, moves, 0, pvMove, hashMove);
+
+    worker.pvLength[0] = 0;
+    BitMove bestMove = moves[0];
+    int bestScore = -INFINITE_SCORE;
+    int alpha = -INFINITE_SCORE;
+    const int beta = INFINITE_SCORE;
+
+    for (int i = 0; i < moves.size(); i++) {
+        pickMove(moves, i);
+        const BitMove move = moves[i];
+        worker.moveStack[0] = move;
+        worker.followPv = (move == pvMove);
+        state.pushMove(move);
+        int score = -negamax(worker, depth - 1, 1, -beta, -alpha);
+        state.popMove();
+        if (_stop.load(std::memory_order_relaxed)) {
+            return bestScore;
+        }
+
+        if (score > bestScore) {
+            bestScore = score;
+            bestMove = move;
+            worker.pv[0][0] = move;
+            for (int i = 1; i < worker.pvLength[1]; i++) {
+                worker.pv[0][i] = worker.pv[1][i];
+            }
+            worker.pvLength[0] = std::max(worker.pvLength[1], 1);
+        }
+        alpha = std::max(alpha, score);
+    }
+    _tt.store(state._zobristHash, bestMove, scoreToTT(bestScore, 0), depth, TTExact);
+    return bestScore;
+}
+
+int ChessAI::negamax(SearchWorker& worker, int depth, int ply, int alpha, int beta) {
+    GameState& state = worker.state;
+    // built once here, then check detection, the evaluation and SEE in move ordering all read them
+    state.computeAttackMaps();
+    // a side in check gets one more ply, so forcing lines are followed to the end
+    const bool inCheck = state.inCheck();
+    if (inCheck) {
+        depth++;
+    }
+    if (depth <= 0 || ply >= MAX_PLY) {
+        return quiesce(worker, ply, alpha, beta);
+    }
+    if ((++worker.nodes % CHECK_INTERVAL) == 0) {
+        checkLimits(worker);
+    }
+    if (_stop.load(std::memory_order_relaxed)) {
+        return 0;
+    }
+    worker.pvLength[ply] = ply;
+    // fifty moves without a capture or a pawn move is a draw
+    if (state.halfmoveClock >= 100) {
+        return 0;
+    }
+    // only the first child of a node on the previous principal variation is still on it
+    const bool onPv = worker.followPv;
+    worker.followPv = false;
+
+    // once few enough pieces are left the tables settle the whole subtree
+    BitbaseResult wdl;
+    if (state._bitboards[OCCUPANCY].countBits() <= BITBASE_MAX_PIECES && state.probeBitbases(wdl)) {
+        if (wdl == BitbaseDraw) {
+            return 0;
+        }
+        const int eval = std::clamp(evaluate(worker), -BITBASE_EVAL_LIMIT, BITBASE_EVAL_LIMIT);
+        return wdl == BitbaseWin ? BITBASE_WIN_SCORE + eval : -BITBASE_WIN_SCORE + eval;
+    }
+
+    // a deep enough table entry can answer this node outright, otherwise it still gives the best move
+    const int alphaOrig = alpha;
+    TTData ttData;
+    BitMove hashMove;
+    if (_tt.probe(state._zobristHash, ttData)) {
+        hashMove = ttData.move;
+        if (ttData.depth >= depth) {
+            int ttScore = scoreFromTT(ttData.score, ply);
+            if (ttData.bound == TTExact ||
+                (ttData.bound == TTLower && ttScore >= beta) ||
+                (ttData.bound == TTUpper && ttScore <= alpha)) {
+                return ttScore;
+            }
+        }
+    }
+
+    MoveList moves;
+    state.generateAllMoves(moves);
+    if (moves.empty()) {
+        // checkmate scores prefer the shortest mate, stalemate is a draw
+        return inCheck ? -MATE_SCORE + ply : 0;
+    }
+    const BitMove pvMove = (onPv && ply < worker.prevPvLength) ? worker.prevPv[ply] : BitMove();
+    orderMoves(worker, moves, ply, pvMove, hashMove);
+
+    int maxScore = -INFINITE_SCORE;
+    BitMove bestMove;
+    for (int i = 0; i < moves.size(); i++) {
+        pickMove(moves, i);
+        const BitMove move = moves[i];
+        worker.moveStack[ply] = move;
+        worker.followPv = onPv && move == pvMove;
+        state.pushMove(move);
+        int score = -negamax(worker, depth - 1, ply + 1, -beta, -alpha);
+        state.popMove();
+        if (_stop.load(std::memory_order_relaxed)) {
+            return 0;
+        }
+
+        if (score > maxScore) {
+            maxScore = score;
+            bestMove = move;
+        }
+        if (score > alpha) {
+            alpha = score;
+            worker.pv[ply][ply] = move;
+            for (int i = ply + 1; i < worker.pvLength[ply + 1]; i++) {
+                worker.pv[ply][i] = worker.pv[ply + 1][i];
+            }
+            worker.pvLength[ply] = std::max(worker.pvLength[ply + 1], ply + 1);
+        }
+        if (alpha >= beta) {
+            if (!move.isCapture() && !move.isPromotion()) {
+                updateQuietCutoff(worker, move, ply, depth);
+            }
+            break;
+        }
+    }
+
+    TTBound bound = (maxScore >= beta) ? TTLower : (maxScore > alphaOrig ? TTExact : TTUpper);
+    _tt.store(state._zobristHash, bestMove, scoreToTT(maxScore, ply), depth, bound);
+    return maxScore;
+}
+
+int ChessAI::quiesce(SearchWorker& worker, int ply, int alpha, int beta) {
+    GameState& state = worker.state;
+    if ((++worker.nodes % CHECK_INTERVAL) == 0) {
+        checkLimits(worker);
+    }
+    if (_stop.load(std::memory_order_relaxed)) {
+        return 0;
+    }
+    worker.pvLength[ply] = ply;
+    worker.followPv = false;
+    if (ply >= MAX_PLY) {
+        return evaluate(worker);
+    }
+    // built once here, then check detection, the evaluation and SEE in move ordering all read them
+    state.computeAttackMaps();
+
+    // in check every evasion has to be looked at, otherwise the side to move can stand pat
+    const bool inCheck = state.inCheck();
+    int standPat = -INFINITE_SCORE;
+    MoveList moves;
+    if (inCheck) {
+        state.generateAllMoves(moves);
+        if (moves.empty()) {
+            return -MATE_SCORE + ply;
+        }
+    } else {
+        standPat = evaluate(worker);
+        if (standPat >= beta) {
+            return standPat;
+        }
+        alpha = std::max(alpha, standPat);
+        state.generateCaptures(moves);
+    }
+    orderMoves(worker, moves, ply, BitMove(), BitMove());
+
+    int maxScore = standPat;
+    for (int i = 0; i < moves.size(); i++) {
+        pickMove(moves, i);
+        const BitMove move = moves[i];
+        worker.moveStack[ply] = move;
+        if (!inCheck) {
+            // delta pruning: even winning the piece outright can't bring this node back up to alpha
+            const int victim = captureGain(state, move);
+            if (standPat + victim + DELTA_MARGIN <= alpha) {
+                continue;
+            }
+            // captures that lose material in the exchange are never better than standing pat
+            if (state.see(move) < 0) {
+                continue;
+            }
+        }
+        state.pushMove(move);
+        int score = -quiesce(worker, ply + 1, -beta, -alpha);
+        state.popMove();
+        if (_stop.load(std::memory_order_relaxed)) {
+            return 0;
+        }
+
+        if (score > maxScore) {
+            maxScore = score;
+        }
+        if (score > alpha) {
+            alpha = score;
+            worker.pv[ply][ply] = move;
+            for (int i = ply + 1; i < worker.pvLength[ply + 1]; i++) {
+                worker.pv[ply][i] = worker.pv[ply + 1][i];
+            }
+            worker.pvLength[ply] = std::max(worker.pvLength[ply + 1], ply + 1);
+        }
+        if (alpha >= beta) {
+            break;
+        }
+    }
+    return maxScore;
+}
+
+// history counts deeper cutoffs for more, everything is halved before it can reach the killer scores
+void ChessAI::updateQuietCutoff(SearchWorker& worker, const BitMove& move, int ply, int depth) {
+    BitMove (&killers)[2] = worker.killers[ply];
+    if (!(killers[0] == move)) {
+        killers[1] = killers[0];
+        killers[0] = move;
+    }
+    if (ply > 0) {
+        const BitMove& previous = worker.moveStack[ply - 1];
+        worker.counterMoves[previous.from()][previous.to()] = move;
+    }
+
+    int (&table)[64][64] = worker.history[worker.state.color == WHITE ? 0 : 1];
+    table[move.from()][move.to()] += depth * depth;
+    if (table[move.from()][move.to()] > HISTORY_MAX) {
+        for (int from = 0; from < 64; from++) {
+            for (int to = 0; to < 64; to++) {
+                table[from][to] /= 2;
+            }
+        }
+    }
+}
+
+void ChessAI::checkLimits(SearchWorker& worker) {
+    const uint64_t total = _sharedNodes.fetch_add(CHECK_INTERVAL, std::memory_order_relaxed) + CHECK_INTERVAL;
+    if (_limits.maxNodes > 0 && total >= _limits.maxNodes) {
+        _stop = true;
+    }
+    if (_limits.hardTimeMs > 0 && elapsedMs() >= _limits.hardTimeMs) {
+        _stop = true;
+    }
+}
+
+int ChessAI::elapsedMs() const {
+    return (int)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - _startTime).count();
+}
+
+// the network when one is loaded, kept clear of the mate scores
+// otherwise the piece-square sums kept by pushMove plus the pawn structure, which comes from the thread's
+// pawn table nearly every time, plus the attack map terms, with the midgame and endgame halves blended
+// by how much material is left, from the point of view of the side to move
+int ChessAI::evaluate(SearchWorker& worker) {
+    GameState& state = worker.state;
+    if (state._network) {
+        const int score = state._network->evaluate(state.accumulator(), state.color == WHITE ? 0 : 1);
+        return std::clamp(score, -MATE_BOUND + 1, MATE_BOUND - 1);
+    }
+    const PawnEntry& pawns = worker.pawnTable.probe(state);
+    state.computeAttackMaps();
+    const int packed = state._psqScore + pawns.score + pawnExtras(state, pawns, 0) - pawnExtras(state, pawns, 1) +
+                       attackTerms(state, 0) - attackTerms(state, 1);
+    const int phase = std::min<int>(state._phase, MAX_PHASE);
+    const int score = (mgScore(packed) * phase + egScore(packed) * (MAX_PHASE - phase)) / MAX_PHASE;
+    return state.color == WHITE ? score : -score;
+}
+
+// previous principal variation move, hash move, winning and even captures by most valuable victim and then
+// least valuable attacker, killers, countermove, quiet moves by history, and last the captures that lose material by SEE
+// only the scores are filled in here, pickMove() does the ordering as the search goes
+void ChessAI::orderMoves(SearchWorker& worker, MoveList& moves, int ply, const BitMove& pvMove, const BitMove& hashMove) {
+    // by bitboard index within one color
+    static const int attackerValues[] = {100, 310, 330, 500, 900, 20000};
+    const GameState& state = worker.state;
+    const int (&history)[64][64] = worker.history[state.color == WHITE ? 0 : 1];
+    const BitMove (&killers)[2] = worker.killers[ply];
+    const BitMove counterMove = (ply > 0) ? worker.counterMoves[worker.moveStack[ply - 1].from()][worker.moveStack[ply - 1].to()] : BitMove();
+    for (int i = 0; i < moves.size(); i++) {
+        const BitMove& move = moves[i];
+        int score;
+        if (move == pvMove) {
+            score = PV_MOVE_SCORE;
+        } else if (move == hashMove) {
+            score = HASH_MOVE_SCORE;
+        } else if (move.isCapture() || move.isPromotion()) {
+            const int victim = captureGain(state, move);
+            const int attacker = attackerValues[BitboardLookup[(unsigned char)state.state[move.from()]] % BLACK_PAWNS];
+            score = CAPTURE_SCORE + victim * 8 - attacker / 100;
+            // taking something worth less than the attacker may lose the exchange, those go after the quiet moves
+            if (victim < attacker && !move.isPromotion()) {
+                const int exchange = state.see(move);
+                if (exchange < 0) {
+                    score = exchange;
+                }
+            }
+        } else if (move == killers[0]) {
+            score = KILLER_SCORE;
+        } else if (move == killers[1]) {
+            score = KILLER_SCORE - 1;
+        } else if (move == counterMove) {
+            score = COUNTER_MOVE_SCORE;
+        } else {
+            score = history[move.from()][move.to()];
+        }
+        moves.scores[i] = score;
+    }
+}
+
+void ChessAI::pickMove(MoveList& moves, int index) {
+    int best = index;
+    for (int i = index + 1; i < moves.size(); i++) {
+        if (moves.scores[i] > moves.scores[best]) {
+            best = i;
+        }
+    }
+    if (best != index) {
+        moves.swap(index, best);
+    }
+}
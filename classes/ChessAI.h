@@ -0,0 +1,175 @@
+#pragma once
+
+#include <cstdint>
+#include <chrono>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "GameState.h"
+#include "TranspositionTable.h"
+#include "ThreadPool.h"
+#include "PawnHashTable.h"
+#include "OpeningBook.h"
+
+// score constants for the search, mate scores are adjusted by ply so shorter mates score higher
+// everything fits in 16 bits so scores can be packed into transposition table entries
+constexpr int MATE_SCORE = 30000;
+constexpr int MATE_BOUND = MATE_SCORE - 1000;   // anything beyond this is a mate score
+constexpr int INFINITE_SCORE = 32000;
+// positions the endgame tables call won, below the mate scores so a mate the search finds still counts for more
+// the static evaluation is added on top, so the search keeps making progress inside a won table
+constexpr int BITBASE_WIN_SCORE = 20000;
+constexpr int BITBASE_EVAL_LIMIT = 2000;
+// default transposition table size in megabytes
+constexpr int DEFAULT_HASH_MB = 16;
+// deepest ply any node may reach, bounded by the per ply search tables (the undo stack itself grows)
+constexpr int MAX_PLY = MAX_DEPTH - 1;
+// deepest iteration the search will start, leaving the remaining plies to the quiescence search
+constexpr int MAX_SEARCH_DEPTH = MAX_DEPTH / 2;
+
+//
+// budget for one search, zero means no limit
+// iterations stop starting once the soft time is used, the hard time and node limits abort mid iteration
+//
+struct SearchLimits {
+    int maxDepth = MAX_SEARCH_DEPTH;
+    int softTimeMs = 0;
+    int hardTimeMs = 0;
+    uint64_t maxNodes = 0;
+};
+
+// what the last search finished with
+struct SearchResult {
+    BitMove bestMove;
+    int score = 0;
+    int depth = 0;          // last fully completed iteration
+    uint64_t nodes = 0;     // summed over all threads
+    int timeMs = 0;
+};
+
+// one finished iteration of the main search thread, pv points into the searching thread's tables
+struct SearchInfo {
+    int depth;
+    int score;
+    uint64_t nodes;
+    int timeMs;
+    uint64_t nps;
+    const BitMove* pv;
+    int pvLength;
+};
+
+//
+// everything one search thread owns, the transposition table is the only state threads share
+//
+struct SearchWorker {
+    int id = 0;
+    GameState state;
+    PawnHashTable pawnTable;
+    uint64_t nodes = 0;
+
+    // triangular principal variation, row ply holds the line found from that ply
+    BitMove pv[MAX_DEPTH + 1][MAX_DEPTH + 1];
+    int pvLength[MAX_DEPTH + 1];
+    // the previous iteration's line is searched first in the next one
+    BitMove prevPv[MAX_DEPTH + 1];
+    int prevPvLength = 0;
+    bool followPv = false;
+
+    // move played at each ply, so a node knows what it is answering
+    BitMove moveStack[MAX_DEPTH + 1];
+    // two quiet moves per ply that caused cutoffs in sibling nodes
+    BitMove killers[MAX_DEPTH + 1][2];
+    // the quiet move that last refuted each previous move, by its from and to square
+    BitMove counterMoves[64][64];
+    // quiet moves that caused cutoffs, by side to move, from and to square
+    int history[2][64][64];
+
+    BitMove bestMove;
+    int score = 0;
+    int completedDepth = 0;
+};
+
+//
+// bitboard search backend for the chess AI
+// the caller snapshots the board into a GameState once, the search then only
+// touches bitboards and hands back a BitMove to apply to the Grid
+// with more than one thread the search is lazy SMP: every thread searches the same root
+// with its own state and history, and they help each other only through the shared table
+//
+class ChessAI {
+public:
+    ChessAI();
+    ~ChessAI();
+
+    // every search has a generation number, findBestMove starts a new one unless prepareSearch already did
+    // a caller that runs the search on another thread prepares it first, so a stop() that comes in while
+    // that thread is still starting up ends the search it starts
+    void prepareSearch();
+    // iterative deepening from depth 1 until a limit is reached
+    BitMove findBestMove(GameState& state, const SearchLimits& limits);
+    // fixed depth search, without a time or node limit it only stops when the depth is done or on stop()
+    BitMove findBestMove(GameState& state, int depth);
+
+    // ends the running or prepared search from another thread, findBestMove then returns the best move found so far
+    // one call is enough, and a stop() for a search that has already returned doesn't reach the next one
+    void stop();
+    // called after every finished iteration, nothing is reported without one
+    void setInfoCallback(std::function<void(const SearchInfo&)> callback) { _infoCallback = std::move(callback); }
+
+    // helper threads are created here once and reused by every search
+    void setThreads(int threads);
+    int threads() const { return (int)_workers.size(); }
+
+    uint64_t nodes() const { return _result.nodes; }
+    const SearchResult& lastResult() const { return _result; }
+    TranspositionTable& transpositionTable() { return _tt; }
+
+    // evaluate with a network file from now on, the piece-square tables are used while none is loaded
+    bool loadNetwork(const std::string& path) { return _network.load(path); }
+    const NnueNetwork& network() const { return _network; }
+    // win/draw/loss tables written by bitbasegen, probed once few enough pieces are left
+    bool loadBitbases(const std::string& path) { return _bitbases.load(path); }
+    const Bitbases& bitbases() const { return _bitbases; }
+    // opening book written by bookgen, a position in it is answered from the book without searching
+    bool loadBook(const std::string& path) { return _book.load(path); }
+    const OpeningBook& book() const { return _book; }
+
+private:
+    void iterate(SearchWorker& worker);
+    int searchRoot(SearchWorker& worker, MoveList& moves, int depth);
+    int negamax(SearchWorker& worker, int depth, int ply, int alpha, int beta);
+    // captures only until the position is quiet, so leaf scores don't hang on a pending exchange
+    int quiesce(SearchWorker& worker, int ply, int alpha, int beta);
+    int evaluate(SearchWorker& worker);
+    void orderMoves(SearchWorker& worker, MoveList& moves, int ply, const BitMove& pvMove, const BitMove& hashMove);
+    // swaps the best scored move left into 'index', so a cutoff doesn't pay for sorting the whole list
+    void pickMove(MoveList& moves, int index);
+    // remember a quiet move that caused a beta cutoff in the killer, countermove and history tables
+    void updateQuietCutoff(SearchWorker& worker, const BitMove& move, int ply, int depth);
+    // with the root in the tables, keeps only the moves that hold its result and searches those without probing
+    void filterRootMoves(GameState& state, MoveList& moves);
+    // called every few thousand nodes, sets _stop once the hard time or node limit is hit
+    void checkLimits(SearchWorker& worker);
+    int elapsedMs() const;
+
+    TranspositionTable _tt;
+    NnueNetwork _network;
+    Bitbases _bitbases;
+    OpeningBook _book;
+    uint64_t _bookSeed;                  // picks between the book moves, so the AI doesn't always open the same way
+    std::function<void(const SearchInfo&)> _infoCallback;
+    std::vector<std::unique_ptr<SearchWorker>> _workers;
+    std::unique_ptr<ThreadPool> _pool;   // runs workers 1..n-1, worker 0 searches on the caller
+
+    SearchLimits _limits;
+    SearchResult _result;
+    MoveList _rootMoves;                 // every thread searches these, the legal moves less any the tables rule out
+    bool _probeBitbases = false;         // off when the root itself is in the tables
+    std::chrono::steady_clock::time_point _startTime;
+    std::atomic<bool> _stop;             // ends the running search, set by stop() and the limits
+    std::atomic<uint64_t> _generation;   // the latest search started or prepared
+    std::atomic<uint64_t> _stopTarget;   // the search stop() was last called for
+    std::atomic<bool> _prepared;         // prepareSearch started a generation findBestMove hasn't picked up yet
+    std::atomic<uint64_t> _sharedNodes;  // node counts published by the threads for the node limit
+};
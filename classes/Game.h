@@ -39,8 +39,11 @@ struct GameOptions
 	int gameNumber;
 	unsigned int currentTurnNo;
 	int score;
-	int AIDepthSearches;
-	int AIMAXDepth;
+	int AIDepthSearches;		// depth the last AI search completed
+	int AIMAXDepth;			// deepest iteration the AI may search, 0 for no limit
+	int AITimeLimitMS;		// hard time budget per AI move, 0 for no limit
+	unsigned long long AIMAXNodes;	// node budget per AI move, 0 for no limit
+	int AIThreads;			// search threads the AI may use
 	bool AIvsAI;
 };
 
@@ -1,152 +1,329 @@
 
 #include <algorithm>
+#include <cstdlib>
 #include <iostream>
 #include "GameState.h"
-#include "MagicBitboards.h"
+#include "SliderAttacks.h"
 
-static int _bitboardLookup[128];
-static bool _initedMagic = false;
-static BitBoard _pawnAttacks[2][64]; // Precomputed pawn attacks for each square
-
-void GameState::init(const char* newState, char player) {
+void GameState::init(const char* newState, char player, int castling, int enPassant, int halfmoves) {
     std::memcpy(state, newState, 64);
     color = player;
     flags = 0;
-    _zobristHash[0] = 0;
-    _zobristHash[1] = 0;
+    castlingRights = castling & 0x0F;
+    enPassantSquare = -1;
+    halfmoveClock = halfmoves;
     _attackBitBoard.setData(0);
-    // Clear all bitboards
-    for (int i = 0; i < e_numBitboards; ++i) {
-        _bitboards[i].setData(0);
+    _undo.clear();
+
+    rebuildBitboards();
+    // same rule as pushMove: only keep it if a pawn of the side to move can capture there
+    if (enPassant >= 0 && enPassant < 64) {
+        const int ourPawns = (color == WHITE) ? WHITE_PAWNS : BLACK_PAWNS;
+        if (PawnAttacks[color == WHITE ? 1 : 0][enPassant] & _bitboards[ourPawns].getData()) {
+            enPassantSquare = enPassant;
+        }
+    }
+    _zobristHash = computeHash();
+    _pawnHash = computePawnHash();
+}
+
+int GameState::computePsqScore() const {
+    int score = 0;
+    for (int i = 0; i < 64; i++) {
+        score += PieceSquare.score[BitboardLookup[(unsigned char)state[i]]][i];
+    }
+    return score;
+}
+
+int GameState::computePhase() const {
+    int phase = 0;
+    for (int i = 0; i < 64; i++) {
+        phase += PieceSquare.phase[BitboardLookup[(unsigned char)state[i]]];
     }
+    return phase;
+}
 
-    if (!_initedMagic) {
-        initMagicBitboards();
-        // remove branching when we make the bitboards
-        for(int i=0; i<128; i++) { _bitboardLookup[i] = 0; }
-
-        _bitboardLookup['P'] = WHITE_PAWNS;
-        _bitboardLookup['N'] = WHITE_KNIGHTS;
-        _bitboardLookup['B'] = WHITE_BISHOPS;
-        _bitboardLookup['R'] = WHITE_ROOKS;
-        _bitboardLookup['Q'] = WHITE_QUEENS;
-        _bitboardLookup['K'] = WHITE_KING;
-        _bitboardLookup['p'] = BLACK_PAWNS;
-        _bitboardLookup['n'] = BLACK_KNIGHTS;
-        _bitboardLookup['b'] = BLACK_BISHOPS;
-        _bitboardLookup['r'] = BLACK_ROOKS;
-        _bitboardLookup['q'] = BLACK_QUEENS;
-        _bitboardLookup['k'] = BLACK_KING;
-        _bitboardLookup['0'] = EMPTY_SQUARES;
-
-        for(int square = 0; square < 64; square++) {
-            _pawnAttacks[0][square].setData(generatePawnAttacksBitBoard(square, WHITE));
-            _pawnAttacks[1][square].setData(generatePawnAttacksBitBoard(square, BLACK));
+uint64_t GameState::computeHash() const {
+    uint64_t hash = 0;
+    for (int i = 0; i < 64; i++) {
+        if (state[i] != '0') {
+            hash ^= ZobristKeys.pieces[BitboardLookup[(unsigned char)state[i]]][i];
         }
+    }
+    hash ^= ZobristKeys.castling[castlingRights];
+    if (enPassantSquare >= 0) {
+        hash ^= ZobristKeys.enPassant[enPassantSquare & 7];
+    }
+    if (color == BLACK) {
+        hash ^= ZobristKeys.side;
+    }
+    return hash;
+}
+
+uint64_t GameState::computePawnHash() const {
+    uint64_t hash = 0;
+    for (int i = 0; i < 64; i++) {
+        hash ^= ZobristKeys.pawns[BitboardLookup[(unsigned char)state[i]]][i];
+    }
+    return hash;
+}
 
-        _initedMagic = true;
+// build every bitboard from the mailbox, only needed when a new position is set up
+void GameState::rebuildBitboards() {
+    for (int i = 0; i < e_numBitboards; i++) {
+        _bitboards[i] = 0;
+    }
 
-        std::cout << "initialized magic bitboards and bitboard lookup" << std::endl;
+    for (int i = 0; i < 64; i++) {
+        int bitIndex = BitboardLookup[(unsigned char)state[i]];
+        _bitboards[bitIndex] |= 1ULL << i;
     }
+
+    _bitboards[WHITE_ALL_PIECES] = _bitboards[WHITE_PAWNS].getData() | _bitboards[WHITE_KNIGHTS].getData() |
+    _bitboards[WHITE_BISHOPS].getData() | _bitboards[WHITE_ROOKS].getData() |
+    _bitboards[WHITE_QUEENS].getData() | _bitboards[WHITE_KING].getData();
+
+    _bitboards[BLACK_ALL_PIECES] = _bitboards[BLACK_PAWNS].getData() | _bitboards[BLACK_KNIGHTS].getData() |
+    _bitboards[BLACK_BISHOPS].getData() | _bitboards[BLACK_ROOKS].getData() |
+    _bitboards[BLACK_QUEENS].getData() | _bitboards[BLACK_KING].getData();
+
+    _bitboards[OCCUPANCY] = _bitboards[WHITE_ALL_PIECES].getData() | _bitboards[BLACK_ALL_PIECES].getData();
+    _bitboards[EMPTY_SQUARES] = ~_bitboards[OCCUPANCY].getData();
+    _psqScore = computePsqScore();
+    _phase = computePhase();
+    if (_network)
+        refreshAccumulator();
 }
 
-void GameState::shutdown() {
-    cleanupMagicBitboards();
+void GameState::attachNetwork(const NnueNetwork* network) {
+    _network = (network && network->isLoaded()) ? network : nullptr;
+    if (_network)
+        refreshAccumulator();
 }
 
-void GameState::addPawnBitboardMovesToList(std::vector<BitMove>& moves, const BitBoard bitboard, const int shift) {
-    if (bitboard.getData() == 0)
-        return;
-    bitboard.forEachBit([&](int toSquare) {
-        int fromSquare = toSquare - shift; // Correct calculation for fromSquare
-        moves.emplace_back(fromSquare, toSquare, Pawn);
+void GameState::refreshAccumulator() {
+    const int ply = _undo.size();
+    if ((int)_accumulators.size() <= ply)
+        _accumulators.resize(ply + 1);
+    _network->refresh(_accumulators[ply], 0, *this);
+    _network->refresh(_accumulators[ply], 1, *this);
+}
+
+void GameState::updateAccumulator(const BitMove& move, unsigned char moved, unsigned char captured) {
+    const int ply = _undo.size();
+    if ((int)_accumulators.size() <= ply)
+        _accumulators.resize(ply + 1);
+    const NnueAccumulator& previous = _accumulators[ply - 1];
+    NnueAccumulator& current = _accumulators[ply];
+
+    const int from = move.from();
+    const int to = move.to();
+    const int type = move.type();
+    const int moverIdx = BitboardLookup[moved];
+    const int mover = (color == WHITE) ? 0 : 1;
+    NnueDelta delta;
+    if (moverIdx % BLACK_PAWNS != WHITE_KING) {
+        delta.remove(moverIdx, from);
+        delta.add((type & IsPromotion) ? moverIdx - WHITE_PAWNS + WHITE_KNIGHTS + (type & 3) : moverIdx, to);
+    }
+    if (captured != '0') {
+        delta.remove(BitboardLookup[captured], to);
+    } else if (type == EnPassant) {
+        delta.remove(mover ? WHITE_PAWNS : BLACK_PAWNS, mover ? to + 8 : to - 8);
+    } else if (type == KingCastle || type == QueenCastle) {
+        const int rookIdx = moverIdx - WHITE_KING + WHITE_ROOKS;
+        delta.remove(rookIdx, (type == KingCastle) ? to + 1 : to - 2);
+        delta.add(rookIdx, (type == KingCastle) ? to - 1 : to + 1);
+    }
+
+    // every input of the side whose king moved changes, the other side only sees the pieces that moved
+    for (int perspective = 0; perspective < 2; perspective++) {
+        if (perspective == mover && moverIdx % BLACK_PAWNS == WHITE_KING) {
+            _network->refresh(current, perspective, *this);
+        } else {
+            _network->update(previous, current, perspective, *this, delta);
+        }
+    }
+}
+
+void GameState::initFEN(const std::string& fen) {
+    char newState[64];
+    std::memset(newState, '0', sizeof(newState));
+
+    size_t space = fen.find(' ');
+    std::string placement = fen.substr(0, space);
+    int rank = 7;
+    int file = 0;
+    for (char c : placement) {
+        if (c == '/') {
+            rank--;
+            file = 0;
+        } else if (c >= '1' && c <= '8') {
+            file += c - '0';
+        } else if (rank >= 0 && file < 8) {
+            newState[rank * 8 + file] = c;
+            file++;
+        }
+    }
+
+    // the remaining fields are optional: side to move, castling rights, en passant square and halfmove clock
+    std::string fields[4];
+    size_t pos = space;
+    for (int i = 0; i < 4 && pos != std::string::npos; i++) {
+        size_t start = fen.find_first_not_of(' ', pos);
+        if (start == std::string::npos)
+            break;
+        pos = fen.find(' ', start);
+        fields[i] = fen.substr(start, pos == std::string::npos ? std::string::npos : pos - start);
+    }
+
+    int castling = 0;
+    for (char c : fields[1]) {
+        if (c == 'K') castling |= WhiteKingSide;
+        if (c == 'Q') castling |= WhiteQueenSide;
+        if (c == 'k') castling |= BlackKingSide;
+        if (c == 'q') castling |= BlackQueenSide;
+    }
+    int enPassant = -1;
+    if (fields[2].size() == 2 && fields[2][0] >= 'a' && fields[2][0] <= 'h' && fields[2][1] >= '1' && fields[2][1] <= '8') {
+        enPassant = (fields[2][1] - '1') * 8 + (fields[2][0] - 'a');
+    }
+    const int halfmoves = fields[3].empty() ? 0 : std::clamp(std::atoi(fields[3].c_str()), 0, 0xFFFF);
+    init(newState, fields[0] == "b" ? BLACK : WHITE, castling, enPassant, halfmoves);
+}
+
+template <int Color, int Shift, bool CapturesOnly>
+inline void GameState::addPawnBitboardMovesToList(MoveList& moves, const uint64_t bitboard, const int type) {
+    BitBoard(bitboard & ~SideTraits<Color>::PromotionRank).forEachBit([&](int toSquare) {
+        moves.add(toSquare - Shift, toSquare, type);
+    });
+    // pawns landing on the last rank always promote, the quiescence search only looks at queens
+    BitBoard(bitboard & SideTraits<Color>::PromotionRank).forEachBit([&](int toSquare) {
+        const int promotion = (type & IsCapture) | IsPromotion;
+        moves.add(toSquare - Shift, toSquare, promotion | (QueenPromotion & 3));
+        if constexpr (!CapturesOnly) {
+            moves.add(toSquare - Shift, toSquare, promotion | (KnightPromotion & 3));
+            moves.add(toSquare - Shift, toSquare, promotion | (RookPromotion & 3));
+            moves.add(toSquare - Shift, toSquare, promotion | (BishopPromotion & 3));
+        }
     });
 }
 
-void GameState::generatePawnMoveList(std::vector<BitMove>& moves, const BitBoard pawns, const BitBoard emptySquares, const BitBoard enemyPieces, char color) {
-    if (pawns.getData() == 0)
+template <int Color, bool CapturesOnly>
+inline void GameState::generatePawnMoveList(MoveList& moves, const uint64_t pawns, const uint64_t emptySquares, const uint64_t enemyPieces, const uint64_t targets) {
+    using Side = SideTraits<Color>;
+    if (pawns == 0)
         return;
 
-    BitBoard demoRight(NotAFile);
-    BitBoard demoLeft(NotHFile);
-
     // Calculate single pawn moves forward
-    BitBoard singleMoves = (color == WHITE) ? (pawns.getData() << 8) & emptySquares.getData() : (pawns.getData() >> 8) & emptySquares.getData();
-    // Calculate double pawn moves from starting rank
-    BitBoard doubleMoves = (color == WHITE) ? ((singleMoves.getData() & Rank3) << 8) & emptySquares.getData() : ((singleMoves.getData() & Rank6) >> 8) & emptySquares.getData();
+    const uint64_t singleMoves = shiftBy<Side::Forward>(pawns) & emptySquares;
+    // Calculate double pawn moves from starting rank, the single step only has to be empty
+    const uint64_t doubleMoves = shiftBy<Side::Forward>(singleMoves & Side::DoublePushRank) & emptySquares;
     // Calculate left and right pawn captures
-    BitBoard capturesLeft = (color == WHITE) ? ((pawns.getData() & NotAFile) << 7) & enemyPieces.getData() : ((pawns.getData() & NotAFile) >> 9) & enemyPieces.getData();
-    BitBoard capturesRight = (color == WHITE) ? ((pawns.getData() & NotHFile) << 9) & enemyPieces.getData() : ((pawns.getData() & NotHFile) >> 7) & enemyPieces.getData();
+    const uint64_t capturesLeft = shiftBy<Side::CaptureLeft>(pawns & NotAFile) & enemyPieces;
+    const uint64_t capturesRight = shiftBy<Side::CaptureRight>(pawns & NotHFile) & enemyPieces;
 
-    int shiftForward = (color == WHITE) ? 8 : -8;
-    int doubleShift = (color == WHITE) ? 16 : -16;
-    int captureLeftShift = (color == WHITE) ? 7 : -9;
-    int captureRightShift = (color == WHITE) ? 9 : -7;
-    
-    // Add single pawn moves to the list
-    addPawnBitboardMovesToList(moves, singleMoves, shiftForward);
+    addPawnBitboardMovesToList<Color, Side::Forward, CapturesOnly>(moves, singleMoves & targets);
+    addPawnBitboardMovesToList<Color, 2 * Side::Forward, CapturesOnly>(moves, doubleMoves & targets, DoublePawnPush);
+    addPawnBitboardMovesToList<Color, Side::CaptureLeft, CapturesOnly>(moves, capturesLeft & targets, Capture);
+    addPawnBitboardMovesToList<Color, Side::CaptureRight, CapturesOnly>(moves, capturesRight & targets, Capture);
+}
 
-    // Add double pawn moves to the list
-    addPawnBitboardMovesToList(moves, doubleMoves, doubleShift);
+//
+// the king may castle when the right is still there, the squares up to the rook are empty
+// and it doesn't start in, cross or land on an attacked square
+//
+template <int Color>
+void GameState::generateCastles(MoveList& moves, uint64_t occupancy, uint64_t enemyAttacks) {
+    using Side = SideTraits<Color>;
+    constexpr int king = Side::KingStart;
+    const uint64_t rooks = _bitboards[WHITE_ROOKS + Side::Offset].getData();
+    if (_kingSquare != king || _checkers)
+        return;
+    if ((castlingRights & Side::KingSideRight) && (rooks & (1ULL << (king + 3))) &&
+        !(occupancy & LineMasks.between[king][king + 3]) &&
+        !(enemyAttacks & ((1ULL << (king + 1)) | (1ULL << (king + 2))))) {
+        moves.add(king, king + 2, KingCastle);
+    }
+    if ((castlingRights & Side::QueenSideRight) && (rooks & (1ULL << (king - 4))) &&
+        !(occupancy & LineMasks.between[king][king - 4]) &&
+        !(enemyAttacks & ((1ULL << (king - 1)) | (1ULL << (king - 2))))) {
+        moves.add(king, king - 2, QueenCastle);
+    }
+}
+
+//
+// en passant takes two pieces off the board at once, which can uncover a slider on the king
+// along the rank that no pin mask sees, so each capture is checked against the sliders directly
+//
+template <int Color, bool CapturesOnly>
+void GameState::generateEnPassant(MoveList& moves, uint64_t occupancy) {
+    using Side = SideTraits<Color>;
+    if (enPassantSquare < 0)
+        return;
+    const int to = enPassantSquare;
+    const int captured = to - Side::Forward;
+    // the capture has to take the checking pawn or block the check
+    if (!(_checkMask & ((1ULL << to) | (1ULL << captured))))
+        return;
+    const uint64_t enemyQueens = _bitboards[WHITE_QUEENS + Side::EnemyOffset].getData();
+    const uint64_t enemyStraight = _bitboards[WHITE_ROOKS + Side::EnemyOffset].getData() | enemyQueens;
+    const uint64_t enemyDiagonal = _bitboards[WHITE_BISHOPS + Side::EnemyOffset].getData() | enemyQueens;
+    const uint64_t attackers = PawnAttacks[1 - Side::PawnAttackIndex][to] & _bitboards[WHITE_PAWNS + Side::Offset].getData();
+    BitBoard(attackers).forEachBit([&](int from) {
+        const uint64_t after = occupancy ^ (1ULL << from) ^ (1ULL << to) ^ (1ULL << captured);
+        if ((rookAttacks(_kingSquare, after) & enemyStraight) || (bishopAttacks(_kingSquare, after) & enemyDiagonal))
+            return;
+        moves.add(from, to, EnPassant);
+    });
+}
+
+// pinned pieces may only move along the line through their king and the pinning piece
+inline uint64_t GameState::pinRay(int square) const {
+    return (_pinned & (1ULL << square)) ? LineMasks.line[_kingSquare][square] : ~0ULL;
+}
 
-    // Add pawn captures to the list
-    addPawnBitboardMovesToList(moves, capturesLeft, captureLeftShift);
-    addPawnBitboardMovesToList(moves, capturesRight, captureRightShift);
+// captures first and then the quiet moves, the destinations never include our own pieces
+inline void GameState::addMovesFrom(MoveList& moves, int fromSquare, uint64_t destinations, uint64_t occupancy) {
+    BitBoard(destinations & occupancy).forEachBit([&](int toSquare) {
+        moves.add(fromSquare, toSquare, Capture);
+    });
+    BitBoard(destinations & ~occupancy).forEachBit([&](int toSquare) {
+        moves.add(fromSquare, toSquare);
+    });
 }
 
 // Generate actual move objects from a bitboard
-void GameState::generateKnightMoves(std::vector<BitMove>& moves, BitBoard knightBoard, uint64_t occupancy) {
+void GameState::generateKnightMoves(MoveList& moves, BitBoard knightBoard, uint64_t occupancy, uint64_t targets) {
     knightBoard.forEachBit([&](int fromSquare) {
-        BitBoard moveBitboard = BitBoard(KnightAttacks[fromSquare] & occupancy);
-        // Efficiently iterate through only the set bits
-        moveBitboard.forEachBit([&](int toSquare) {
-           moves.emplace_back(fromSquare, toSquare, Knight);
-        });
+        addMovesFrom(moves, fromSquare, KnightAttacks[fromSquare] & targets, occupancy);
     });
 }
 
-// Generate actual move objects from a bitboard
-void GameState::generateKingMoves(std::vector<BitMove>& moves, BitBoard piecesBoard, uint64_t occupancy) {
+void GameState::generateKingMoves(MoveList& moves, BitBoard piecesBoard, uint64_t occupancy, uint64_t targets) {
     piecesBoard.forEachBit([&](int fromSquare) {
-        BitBoard moveBitboard = BitBoard(KingAttacks[fromSquare] & occupancy);
-        // Efficiently iterate through only the set bits
-        moveBitboard.forEachBit([&](int toSquare) {
-           moves.emplace_back(fromSquare, toSquare, King);
-        });
+        addMovesFrom(moves, fromSquare, KingAttacks[fromSquare] & targets, occupancy);
     });
 }
 
-// Generate actual move objects from a bitboard
-void GameState::generateBishopMoves(std::vector<BitMove>& moves, BitBoard piecesBoard, uint64_t occupancy, uint64_t friendlies)
+void GameState::generateBishopMoves(MoveList& moves, BitBoard piecesBoard, uint64_t occupancy, uint64_t targets)
 {
     piecesBoard.forEachBit([&](int fromSquare) {
-        BitBoard moveBitboard = BitBoard(getBishopAttacks(fromSquare, occupancy) & ~friendlies);
-        // Efficiently iterate through only the set bits
-        moveBitboard.forEachBit([&](int toSquare) {
-           moves.emplace_back(fromSquare, toSquare, Bishop);
-        });
+        addMovesFrom(moves, fromSquare, bishopAttacks(fromSquare, occupancy) & targets & pinRay(fromSquare), occupancy);
     });
 }
 
-void GameState::generateRooksMoves(std::vector<BitMove>& moves, BitBoard piecesBoard, uint64_t occupancy, uint64_t friendlies)
+void GameState::generateRooksMoves(MoveList& moves, BitBoard piecesBoard, uint64_t occupancy, uint64_t targets)
 {
     piecesBoard.forEachBit([&](int fromSquare) {
-        BitBoard moveBitboard = BitBoard(getRookAttacks(fromSquare, occupancy) & ~friendlies);
-        // Efficiently iterate through only the set bits
-        moveBitboard.forEachBit([&](int toSquare) {
-           moves.emplace_back(fromSquare, toSquare, Rook);
-        });
+        addMovesFrom(moves, fromSquare, rookAttacks(fromSquare, occupancy) & targets & pinRay(fromSquare), occupancy);
     });
 }
 
-void GameState::generateQueensMoves(std::vector<BitMove>& moves, BitBoard piecesBoard, uint64_t occupancy, uint64_t friendlies)
+void GameState::generateQueensMoves(MoveList& moves, BitBoard piecesBoard, uint64_t occupancy, uint64_t targets)
 {
     piecesBoard.forEachBit([&](int fromSquare) {
-        BitBoard moveBitboard = BitBoard(getQueenAttacks(fromSquare, occupancy) & ~friendlies);
-        // Efficiently iterate through only the set bits
-        moveBitboard.forEachBit([&](int toSquare) {
-           moves.emplace_back(fromSquare, toSquare, Queen);
-        });
+        addMovesFrom(moves, fromSquare, queenAttacks(fromSquare, occupancy) & targets & pinRay(fromSquare), occupancy);
     });
 }
 
@@ -158,70 +335,31 @@ inline BitBoard generatePieceAttackList(
     BitBoard attacks;
 
     pieces.forEachBit([&](int fromSquare) {
-        // We'll branch on the piece type. 
-        // This uses if constexpr for compile-time resolution
-        if (PIECE_TYPE == Knight) {
-            // Combine all knight moves from `fromSquare`
+        // resolved at compile time, each instantiation keeps only its own lookup
+        if constexpr (PIECE_TYPE == Knight) {
             attacks |= KnightAttacks[fromSquare];
-        }
-        else if (PIECE_TYPE == Bishop) {
-            attacks |= BitBoard(getBishopAttacks(fromSquare, occupancy.getData())); 
-        }
-        else if (PIECE_TYPE == Rook) {
-            attacks |= BitBoard(getRookAttacks(fromSquare, occupancy.getData())); 
-        }
-        else if (PIECE_TYPE == Queen) {
-            // Queen is rook + bishop combined
-            attacks |= (BitBoard(getBishopAttacks(fromSquare, occupancy.getData())) |
-                        BitBoard(getRookAttacks(fromSquare, occupancy.getData())));
-        }
-        else if (PIECE_TYPE == King) {
+        } else if constexpr (PIECE_TYPE == Bishop) {
+            attacks |= BitBoard(bishopAttacks(fromSquare, occupancy.getData()));
+        } else if constexpr (PIECE_TYPE == Rook) {
+            attacks |= BitBoard(rookAttacks(fromSquare, occupancy.getData()));
+        } else if constexpr (PIECE_TYPE == Queen) {
+            attacks |= BitBoard(queenAttacks(fromSquare, occupancy.getData()));
+        } else if constexpr (PIECE_TYPE == King) {
             attacks |= KingAttacks[fromSquare];
-        }
-        else {
-            // Optionally handle or static_assert for unexpected piece types
+        } else {
+            static_assert(PIECE_TYPE == Knight, "pawn attacks are set wise, see attackedSquares");
         }
     });
 
     return attacks;
 }
 
-uint64_t GameState::generatePawnAttacksBitBoard(int square, char color) {
-    uint64_t bitboard = 0ULL;
-    int rank = square / 8;
-    int file = square % 8;
-
-    // Pawns can only attack diagonally forward
-    // For white: up-right and up-left
-    // For black: down-right and down-left
-    const int direction = (color == WHITE) ? 1 : -1;
-    
-    // Check diagonal left attack
-    if (file > 0) {  // Not on a-file
-        int r = rank + direction;
-        int f = file - 1;
-        if (r >= 0 && r < 8) {  // Stay within board bounds
-            bitboard |= 1ULL << (r * 8 + f);
-        }
-    }
-    
-    // Check diagonal right attack
-    if (file < 7) {  // Not on h-file
-        int r = rank + direction;
-        int f = file + 1;
-        if (r >= 0 && r < 8) {  // Stay within board bounds
-            bitboard |= 1ULL << (r * 8 + f);
-        }
-    }
-    return bitboard;
-}
-
 const BitBoard GameState::generatePawnAttacks(const BitBoard pawns, char color) {
     BitBoard result(0);
 
     pawns.forEachBit([&](int fromSquare) {
         // Using precomputed or dynamic logic
-        result |= _pawnAttacks[color == WHITE ? 0 : 1][fromSquare];
+        result |= PawnAttacks[color == WHITE ? 0 : 1][fromSquare];
     });
 
     return result;
@@ -241,7 +379,7 @@ bool GameState::isSquareAttacked(int square, char attackerColor, const BitBoard
 
 	// Check Pawn Attacks
 	char targetColor = (attackerColor == WHITE) ? BLACK : WHITE; 
-	if ((generatePawnAttacksBitBoard(square, targetColor) & boards[pawnIdx].getData()) != 0) return true;
+	if ((PawnAttacks[targetColor == WHITE ? 0 : 1][square] & boards[pawnIdx].getData()) != 0) return true;
 
 	// Check Knight Attacks
 	if ((KnightAttacks[square] & boards[knightIdx].getData()) != 0) return true;
@@ -250,131 +388,275 @@ bool GameState::isSquareAttacked(int square, char attackerColor, const BitBoard
 	if ((KingAttacks[square] & boards[kingIdx].getData()) != 0) return true;
 
 	// Check Bishop/Queen (Diagonal) Attacks
-	uint64_t diagonalAttacks = getBishopAttacks(square, occ.getData());
+	uint64_t diagonalAttacks = bishopAttacks(square, occ.getData());
 	if ((diagonalAttacks & (boards[bishopIdx].getData() | boards[queenIdx].getData())) != 0) return true;
 
 	// Check Rook/Queen (Straight) Attacks
-	uint64_t straightAttacks = getRookAttacks(square, occ.getData());
+	uint64_t straightAttacks = rookAttacks(square, occ.getData());
 	if ((straightAttacks & (boards[rookIdx].getData() | boards[queenIdx].getData())) != 0) return true;
 
 	return false;
 }
 
-void GameState::filterOutIllegalMoves(std::vector<BitMove>& moves) {
-	if (moves.empty()) return;
-
-	const char myColor = color;
-	const char opponentColor = (color == WHITE) ? BLACK : WHITE;
-	const int myKingIdx = (myColor == WHITE) ? WHITE_KING : BLACK_KING;
-
-	// Remove moves that leave the king in check
-	moves.erase(std::remove_if(moves.begin(), moves.end(), [&](const BitMove& move) {
-		
-		// Create a temporary copy of the board state
-		BitBoard tempBoards[e_numBitboards];
-		for (int i = 0; i < e_numBitboards; ++i) tempBoards[i] = _bitboards[i];
-
-		// Apply the move to the temporary boards
-		// Note: We just need occupancy correct for check detection.
-		
-		const uint64_t fromMask = 1ULL << move.from;
-		const uint64_t toMask   = 1ULL << move.to;
-		
-		// Helper to determine which bitboard a piece belongs to
-		auto getPieceIdx = [&](ChessPiece p, char c) {
-			if (p == Pawn) return c == WHITE ? WHITE_PAWNS : BLACK_PAWNS;
-			if (p == Knight) return c == WHITE ? WHITE_KNIGHTS : BLACK_KNIGHTS;
-			if (p == Bishop) return c == WHITE ? WHITE_BISHOPS : BLACK_BISHOPS;
-			if (p == Rook) return c == WHITE ? WHITE_ROOKS : BLACK_ROOKS;
-			if (p == Queen) return c == WHITE ? WHITE_QUEENS : BLACK_QUEENS;
-			return c == WHITE ? WHITE_KING : BLACK_KING; // King
-		};
-
-		int moverIdx = getPieceIdx(static_cast<ChessPiece>(move.piece), myColor);
-		
-		// Remove from 'from'
-		tempBoards[moverIdx] &= ~fromMask;
-		tempBoards[OCCUPANCY] &= ~fromMask;
-
-		// Handle Captures (Remove opponent piece at 'to')
-		// We scan opponent boards to find what was captured (slower than lookup, but safe for generic bitboards)
-		int startOpp = (opponentColor == WHITE) ? WHITE_PAWNS : BLACK_PAWNS;
-		int endOpp   = (opponentColor == WHITE) ? WHITE_KING : BLACK_KING;
-		
-		// Specialized handling for En Passant
-		if (move.flags & EnPassant) {
-			int capSq = (myColor == WHITE) ? (move.to - 8) : (move.to + 8);
-			uint64_t capMask = 1ULL << capSq;
-			tempBoards[startOpp] &= ~capMask; // Opponent Pawns
-			tempBoards[OCCUPANCY] &= ~capMask;
-		} else {
-			// Standard capture
-			for (int i = startOpp; i <= endOpp; ++i) {
-				tempBoards[i] &= ~toMask;
-			}
-			tempBoards[OCCUPANCY] &= ~toMask; // Clear strictly to ensure no overlap before adding
-		}
-
-		// Handle Promotion
-		if ((move.flags & IsPromotion)) {
-			moverIdx = getPieceIdx(Queen, myColor); // Assume Queen promotion for check safety (mostly covers it)
-		}
-
-		// Add to 'to'
-		tempBoards[moverIdx] |= toMask;
-		tempBoards[OCCUPANCY] |= toMask;
-
-		// Handle King Move (Update King Index tracking)
-		int currentKingSquare = -1;
-		if (move.piece == King) {
-			currentKingSquare = move.to;
-		} else {
-			// If king didn't move, find him
-			currentKingSquare = tempBoards[myKingIdx].firstBit();
-		}
-
-		// If the King is attacked by the opponent after this move, the move is illegal.
-		return isSquareAttacked(currentKingSquare, opponentColor, tempBoards);
-
-	}), moves.end());
-}
-
-std::vector<BitMove> GameState::generateAllMoves()
-{
-    std::vector<BitMove> moves;
-    moves.reserve(32);
+bool GameState::inCheck() {
+    const int kingIdx = (color == WHITE) ? WHITE_KING : BLACK_KING;
+    if (_bitboards[kingIdx].getData() == 0)
+        return false;
+    if (flags & AttackMapsValid)
+        return _attackBitBoard.anyCommonBits(_bitboards[kingIdx]);
+    return isSquareAttacked(_bitboards[kingIdx].firstBit(), (color == WHITE) ? BLACK : WHITE, _bitboards);
+}
 
-    for (int i=0; i<e_numBitboards; i++) {
-        _bitboards[i] = 0;
+// every piece of 'attackerColor' that attacks 'square' with the given occupancy
+uint64_t GameState::attackersTo(int square, char attackerColor, uint64_t occupancy) const {
+    const int offset = (attackerColor == WHITE) ? WHITE_PAWNS : BLACK_PAWNS;
+    const uint64_t queens = _bitboards[WHITE_QUEENS + offset].getData();
+    const uint64_t diagonal = _bitboards[WHITE_BISHOPS + offset].getData() | queens;
+    const uint64_t straight = _bitboards[WHITE_ROOKS + offset].getData() | queens;
+
+    // a pawn of 'attackerColor' attacks 'square' if a pawn of the other color on 'square' would attack it
+    return (PawnAttacks[attackerColor == WHITE ? 1 : 0][square] & _bitboards[WHITE_PAWNS + offset].getData())
+         | (KnightAttacks[square] & _bitboards[WHITE_KNIGHTS + offset].getData())
+         | (KingAttacks[square] & _bitboards[WHITE_KING + offset].getData())
+         | (bishopAttacks(square, occupancy) & diagonal)
+         | (rookAttacks(square, occupancy) & straight);
+}
+
+// every square attacked by 'AttackerColor' with the given occupancy
+template <int AttackerColor>
+uint64_t GameState::attackedSquares(uint64_t occupancy) const {
+    constexpr int offset = SideTraits<AttackerColor>::Offset;
+    const uint64_t pawns = _bitboards[WHITE_PAWNS + offset].getData();
+    BitBoard attacks = shiftBy<SideTraits<AttackerColor>::CaptureLeft>(pawns & NotAFile)
+                     | shiftBy<SideTraits<AttackerColor>::CaptureRight>(pawns & NotHFile);
+    attacks |= generatePieceAttackList<Knight>(_bitboards[WHITE_KNIGHTS + offset], occupancy);
+    attacks |= generatePieceAttackList<Bishop>(_bitboards[WHITE_BISHOPS + offset], occupancy);
+    attacks |= generatePieceAttackList<Rook>(_bitboards[WHITE_ROOKS + offset], occupancy);
+    attacks |= generatePieceAttackList<Queen>(_bitboards[WHITE_QUEENS + offset], occupancy);
+    attacks |= generatePieceAttackList<King>(_bitboards[WHITE_KING + offset], occupancy);
+    return attacks.getData();
+}
+
+void GameState::computeAttackMaps() {
+    if (flags & AttackMapsValid)
+        return;
+    const BitBoard occupancy = _bitboards[OCCUPANCY];
+    for (int side = 0; side < 2; side++) {
+        const int offset = side ? BLACK_PAWNS : WHITE_PAWNS;
+        const uint64_t pawns = _bitboards[WHITE_PAWNS + offset].getData();
+        _attacks[WHITE_PAWNS + offset] = side ? (((pawns & NotAFile) >> 9) | ((pawns & NotHFile) >> 7))
+                                              : (((pawns & NotAFile) << 7) | ((pawns & NotHFile) << 9));
+        _attacks[WHITE_KNIGHTS + offset] = generatePieceAttackList<Knight>(_bitboards[WHITE_KNIGHTS + offset], occupancy);
+        _attacks[WHITE_BISHOPS + offset] = generatePieceAttackList<Bishop>(_bitboards[WHITE_BISHOPS + offset], occupancy);
+        _attacks[WHITE_ROOKS + offset] = generatePieceAttackList<Rook>(_bitboards[WHITE_ROOKS + offset], occupancy);
+        _attacks[WHITE_QUEENS + offset] = generatePieceAttackList<Queen>(_bitboards[WHITE_QUEENS + offset], occupancy);
+        _attacks[WHITE_KING + offset] = generatePieceAttackList<King>(_bitboards[WHITE_KING + offset], occupancy);
+
+        // pieces of one type overlapping each other are not counted twice, close enough for the evaluation
+        uint64_t all = 0;
+        uint64_t twice = 0;
+        for (int piece = WHITE_PAWNS; piece <= WHITE_KING; piece++) {
+            const uint64_t attacks = _attacks[piece + offset].getData();
+            twice |= all & attacks;
+            all |= attacks;
+        }
+        _attacks[WHITE_ALL_PIECES + offset] = all;
+        _attackedTwice[side] = twice;
     }
+    _attackBitBoard = _attacks[(color == WHITE) ? BLACK_ALL_PIECES : WHITE_ALL_PIECES];
+    flags |= AttackMapsValid;
+}
 
-    for(int i = 0; i<64; i++) {
-        int bitIndex = _bitboardLookup[(unsigned char)state[i]];
-        _bitboards[bitIndex] |= 1ULL << i;
+//
+// work out the checkers, the squares that resolve a check and the pinned pieces once per position
+// after this every generator can emit only legal moves without making them first
+//
+template <int EnemyColor>
+void GameState::computeCheckAndPins() {
+    constexpr int enemyOffset = SideTraits<EnemyColor>::Offset;
+    const uint64_t occupancy = _bitboards[OCCUPANCY].getData();
+    const uint64_t enemies = _bitboards[WHITE_ALL_PIECES + enemyOffset].getData();
+    const uint64_t enemyQueens = _bitboards[WHITE_QUEENS + enemyOffset].getData();
+
+    _checkers = attackersTo(_kingSquare, EnemyColor, occupancy);
+    if (_checkers == 0) {
+        _checkMask = ~0ULL;
+    } else {
+        // a single checker can be captured or blocked, a double check leaves only king moves
+        int checker = BitBoard(_checkers).firstBit();
+        _checkMask = (_checkers & (_checkers - 1)) ? 0ULL : (_checkers | LineMasks.between[_kingSquare][checker]);
     }
 
-    _bitboards[WHITE_ALL_PIECES] = _bitboards[WHITE_PAWNS].getData() | _bitboards[WHITE_KNIGHTS].getData() |
-    _bitboards[WHITE_BISHOPS].getData() | _bitboards[WHITE_ROOKS].getData() |
-    _bitboards[WHITE_QUEENS].getData() | _bitboards[WHITE_KING].getData();
+    // sliders that would see the king if our own pieces were not in the way
+    _pinned = 0;
+    uint64_t snipers = (rookAttacks(_kingSquare, enemies) & (_bitboards[WHITE_ROOKS + enemyOffset].getData() | enemyQueens))
+                     | (bishopAttacks(_kingSquare, enemies) & (_bitboards[WHITE_BISHOPS + enemyOffset].getData() | enemyQueens));
+    BitBoard(snipers).forEachBit([&](int sniper) {
+        uint64_t blockers = LineMasks.between[_kingSquare][sniper] & occupancy;
+        if (blockers && (blockers & (blockers - 1)) == 0) {
+            _pinned |= blockers & ~enemies;
+        }
+    });
+}
 
-    _bitboards[BLACK_ALL_PIECES] = _bitboards[BLACK_PAWNS].getData() | _bitboards[BLACK_KNIGHTS].getData() |
-    _bitboards[BLACK_BISHOPS].getData() | _bitboards[BLACK_ROOKS].getData() |
-    _bitboards[BLACK_QUEENS].getData() | _bitboards[BLACK_KING].getData();
-    
-    _bitboards[OCCUPANCY] = _bitboards[WHITE_ALL_PIECES].getData() | _bitboards[BLACK_ALL_PIECES].getData();
+void GameState::generateAllMoves(MoveList& moves)
+{
+    if (color == WHITE) {
+        generateMoves<WHITE, false>(moves);
+    } else {
+        generateMoves<BLACK, false>(moves);
+    }
+}
 
-    int bitIndex = color == WHITE ? WHITE_PAWNS : BLACK_PAWNS;
-    int oppBitIndex = color == WHITE ? BLACK_PAWNS : WHITE_PAWNS;
+void GameState::generateCaptures(MoveList& moves)
+{
+    if (color == WHITE) {
+        generateMoves<WHITE, true>(moves);
+    } else {
+        generateMoves<BLACK, true>(moves);
+    }
+}
 
-    generateKnightMoves(moves, _bitboards[WHITE_KNIGHTS + bitIndex], ~_bitboards[WHITE_ALL_PIECES + bitIndex].getData());
-    generatePawnMoveList(moves, _bitboards[WHITE_PAWNS  + bitIndex], ~_bitboards[OCCUPANCY].getData(), _bitboards[WHITE_ALL_PIECES + oppBitIndex].getData(), color);
-    generateKingMoves(moves, _bitboards[WHITE_KING + bitIndex], ~_bitboards[WHITE_ALL_PIECES + bitIndex].getData());
-    generateBishopMoves(moves, _bitboards[WHITE_BISHOPS + bitIndex], _bitboards[OCCUPANCY].getData(), _bitboards[WHITE_ALL_PIECES + bitIndex].getData());
-    generateRooksMoves(moves, _bitboards[WHITE_ROOKS + bitIndex], _bitboards[OCCUPANCY].getData(), _bitboards[WHITE_ALL_PIECES + bitIndex].getData());
-    generateQueensMoves(moves, _bitboards[WHITE_QUEENS + bitIndex], _bitboards[OCCUPANCY].getData(), _bitboards[WHITE_ALL_PIECES + bitIndex].getData());
+template <int Color>
+void GameState::generateAllMoves(MoveList& moves)
+{
+    assert(color == Color);
+    generateMoves<Color, false>(moves);
+}
 
-    filterOutIllegalMoves(moves);
+template <int Color>
+void GameState::generateCaptures(MoveList& moves)
+{
+    assert(color == Color);
+    generateMoves<Color, true>(moves);
+}
 
-    return moves;
+template <int Color, bool CapturesOnly>
+void GameState::generateMoves(MoveList& moves)
+{
+    using Side = SideTraits<Color>;
+    moves.clear();
+
+    const uint64_t occupancy = _bitboards[OCCUPANCY].getData();
+    const uint64_t friendlies = _bitboards[WHITE_ALL_PIECES + Side::Offset].getData();
+    const uint64_t kingBoard = _bitboards[WHITE_KING + Side::Offset].getData();
+    const uint64_t enemies = _bitboards[WHITE_ALL_PIECES + Side::EnemyOffset].getData();
+    // captures only keeps the enemy squares, pawns also keep their promotion pushes
+    const uint64_t filter = CapturesOnly ? enemies : ~0ULL;
+    const uint64_t pawnFilter = CapturesOnly ? (enemies | Side::PromotionRank) : ~0ULL;
+
+    if (kingBoard == 0) {
+        // no king to protect, every pseudo-legal move is fine
+        _kingSquare = 0;
+        _checkers = 0;
+        _checkMask = ~0ULL;
+        _pinned = 0;
+    } else {
+        _kingSquare = BitBoard(kingBoard).firstBit();
+        computeCheckAndPins<Side::Enemy>();
+        // the king can't step onto an attacked square, or slide away from a checker along its line
+        uint64_t enemyAttacks = attackedSquares<Side::Enemy>(occupancy ^ kingBoard);
+        generateKingMoves(moves, kingBoard, occupancy, ~friendlies & ~enemyAttacks & filter);
+        if constexpr (!CapturesOnly) {
+            generateCastles<Color>(moves, occupancy, enemyAttacks);
+        }
+        // in double check only the king can move
+        if (_checkMask == 0)
+            return;
+    }
+
+    const uint64_t targets = ~friendlies & _checkMask & filter;
+    const uint64_t pawnTargets = ~friendlies & _checkMask & pawnFilter;
+    const uint64_t pawns = _bitboards[WHITE_PAWNS + Side::Offset].getData();
+    const uint64_t emptySquares = ~occupancy;
+
+    // a pinned knight can never move
+    generateKnightMoves(moves, _bitboards[WHITE_KNIGHTS + Side::Offset] & ~_pinned, occupancy, targets);
+    generatePawnMoveList<Color, CapturesOnly>(moves, pawns & ~_pinned, emptySquares, enemies, pawnTargets);
+    BitBoard(pawns & _pinned).forEachBit([&](int square) {
+        generatePawnMoveList<Color, CapturesOnly>(moves, 1ULL << square, emptySquares, enemies, pawnTargets & LineMasks.line[_kingSquare][square]);
+    });
+    generateBishopMoves(moves, _bitboards[WHITE_BISHOPS + Side::Offset], occupancy, targets);
+    generateRooksMoves(moves, _bitboards[WHITE_ROOKS + Side::Offset], occupancy, targets);
+    generateQueensMoves(moves, _bitboards[WHITE_QUEENS + Side::Offset], occupancy, targets);
+    generateEnPassant<Color, CapturesOnly>(moves, occupancy);
 }
 
+template void GameState::generateAllMoves<WHITE>(MoveList& moves);
+template void GameState::generateAllMoves<BLACK>(MoveList& moves);
+template void GameState::generateCaptures<WHITE>(MoveList& moves);
+template void GameState::generateCaptures<BLACK>(MoveList& moves);
+
+//
+// swap algorithm: play out every capture on the target square cheapest attacker first,
+// adding sliders hidden behind the pieces that have moved, then let each side stop when capturing loses
+//
+int GameState::see(const BitMove& move) const
+{
+    // by bitboard index within one color
+    static constexpr int values[] = { 100, 310, 330, 500, 900, 20000 };
+    const int to = move.to();
+    uint64_t occupancy = _bitboards[OCCUPANCY].getData();
+    uint64_t fromMask = 1ULL << move.from();
+    const uint64_t bishops = _bitboards[WHITE_BISHOPS].getData() | _bitboards[BLACK_BISHOPS].getData();
+    const uint64_t rooks = _bitboards[WHITE_ROOKS].getData() | _bitboards[BLACK_ROOKS].getData();
+    const uint64_t queens = _bitboards[WHITE_QUEENS].getData() | _bitboards[BLACK_QUEENS].getData();
+    const uint64_t diagonal = bishops | queens;
+    const uint64_t straight = rooks | queens;
+
+    int gain[32];
+    int depth = 0;
+    int attacker = BitboardLookup[(unsigned char)state[move.from()]] % BLACK_PAWNS;
+    gain[0] = (state[to] != '0') ? values[BitboardLookup[(unsigned char)state[to]] % BLACK_PAWNS] : 0;
+    if (move.type() == EnPassant) {
+        gain[0] = values[WHITE_PAWNS];
+        occupancy ^= 1ULL << ((color == WHITE) ? to - 8 : to + 8);
+    }
+    if (move.isPromotion()) {
+        attacker = WHITE_KNIGHTS + (move.type() & 3);
+        gain[0] += values[attacker] - values[WHITE_PAWNS];
+    }
+
+    // nothing of the opponent's reaches the square, and no slider of theirs is lined up behind the capturing piece
+    if ((flags & AttackMapsValid) && move.type() != EnPassant) {
+        const int enemyOffset = (color == WHITE) ? BLACK_PAWNS : WHITE_PAWNS;
+        const uint64_t enemySliders = _attacks[WHITE_BISHOPS + enemyOffset].getData() | _attacks[WHITE_ROOKS + enemyOffset].getData() |
+                                      _attacks[WHITE_QUEENS + enemyOffset].getData();
+        if (!(_attackBitBoard.getData() & (1ULL << to)) && !(enemySliders & fromMask))
+            return gain[0];
+    }
+
+    uint64_t attackers = attackersTo(to, WHITE, occupancy) | attackersTo(to, BLACK, occupancy);
+    char side = color;
+    do {
+        depth++;
+        // what the side that just captured is up if the piece it moved gets taken back
+        gain[depth] = values[attacker] - gain[depth - 1];
+        if (std::max(-gain[depth - 1], gain[depth]) < 0)
+            break;
+        occupancy ^= fromMask;
+        attackers &= ~fromMask;
+        if (attacker == WHITE_PAWNS || attacker == WHITE_BISHOPS || attacker == WHITE_QUEENS)
+            attackers |= bishopAttacks(to, occupancy) & diagonal;
+        if (attacker == WHITE_ROOKS || attacker == WHITE_QUEENS)
+            attackers |= rookAttacks(to, occupancy) & straight;
+        attackers &= occupancy;
+
+        side = (side == WHITE) ? BLACK : WHITE;
+        const int offset = (side == WHITE) ? WHITE_PAWNS : BLACK_PAWNS;
+        fromMask = 0;
+        for (int piece = WHITE_PAWNS; piece <= WHITE_KING; piece++) {
+            const uint64_t candidates = attackers & _bitboards[piece + offset].getData();
+            if (candidates) {
+                fromMask = candidates & (0 - candidates);
+                attacker = piece;
+                break;
+            }
+        }
+    } while (fromMask && depth < 31);
+
+    while (--depth) {
+        gain[depth - 1] = -std::max(-gain[depth - 1], gain[depth]);
+    }
+    return gain[0];
+}
@@ -1,21 +1,30 @@
 #pragma once
 
 #include <assert.h>
+#include <algorithm>
 #include <iostream>
 #include <cstring>
 #include <cstdint>
 #include <vector>
+#include <string>
+#include <utility>
 #include "Bitboard.h"
+#include "PieceSquareTables.h"
+#include "Nnue.h"
+#include "Bitbases.h"
 
 constexpr int WHITE = +1;
 constexpr int BLACK = -1;
-// Define a constant for the maximum depth of your AI.
-constexpr int MAX_DEPTH = 24;
+// Define a constant for the maximum depth of your AI, including quiescence plies and extensions.
+constexpr int MAX_DEPTH = 128;
 // Define constants for ranks and files
 constexpr uint64_t NotAFile(0xFEFEFEFEFEFEFEFEULL); // A file mask
 constexpr uint64_t NotHFile(0x7F7F7F7F7F7F7F7FULL); // H file mask
+constexpr uint64_t Rank1(0x00000000000000FFULL); // Rank 1 mask
 constexpr uint64_t Rank3(0x0000000000FF0000ULL); // Rank 3 mask
 constexpr uint64_t Rank6(0x0000FF0000000000ULL); // Rank 6 mask
+constexpr uint64_t Rank8(0xFF00000000000000ULL); // Rank 8 mask
+constexpr uint64_t PromotionRanks(0xFF000000000000FFULL); // Rank 1 and rank 8
 
 enum AllBitBoards
 {
@@ -38,111 +47,585 @@ enum AllBitBoards
     e_numBitboards
 };
 
-enum MoveFlags {
-    EnPassant = 0x01, // 0000 0001
-    IsCapture = 0x02, // 0000 0010
-    KingCastle = 0x04, // 0000 0100
-    QueenCastle = 0x08, // 0000 1000
-    IsPromotion = 0x10 // 0001 0000
+//
+// 4 bit move type: bit 2 marks captures and bit 3 promotions, the low two bits of a promotion pick
+// knight, bishop, rook or queen
+//
+enum MoveType {
+    QuietMove = 0,
+    DoublePawnPush = 1,
+    KingCastle = 2,
+    QueenCastle = 3,
+    Capture = 4,
+    EnPassant = 5,
+    KnightPromotion = 8,
+    BishopPromotion = 9,
+    RookPromotion = 10,
+    QueenPromotion = 11,
+    KnightPromotionCapture = 12,
+    BishopPromotionCapture = 13,
+    RookPromotionCapture = 14,
+    QueenPromotionCapture = 15
 };
+constexpr int IsCapture = 0x4;
+constexpr int IsPromotion = 0x8;
 
-#pragma pack(push, 1)
+//
+// a move in 16 bits: from in bits 0-5, to in bits 6-11 and the MoveType in bits 12-15
+// the all zero move (a1a1) is never legal and stands for "no move"
+//
 struct BitMove {
-    unsigned char from;
-    unsigned char to;
-    unsigned char piece;
-    unsigned char flags;
-
-    BitMove(int from, int to, ChessPiece piece, int flags = 0)
-        : from(from), to(to), piece(piece), flags(flags) { }
-        
-    BitMove() : from(0), to(0), piece(NoPiece), flags(0) { }
-    
-    bool operator==(const BitMove& other) const {
-        return from == other.from && 
-               to == other.to && 
-               piece == other.piece &&
-               flags == other.flags;
+    uint16_t data;
+
+    constexpr BitMove() : data(0) { }
+    constexpr BitMove(int from, int to, int type = QuietMove)
+        : data((uint16_t)(from | (to << 6) | (type << 12))) { }
+
+    constexpr int from() const { return data & 63; }
+    constexpr int to() const { return (data >> 6) & 63; }
+    constexpr int type() const { return data >> 12; }
+    constexpr bool isCapture() const { return (type() & IsCapture) != 0; }
+    constexpr bool isPromotion() const { return (type() & IsPromotion) != 0; }
+    constexpr bool isCastle() const { return type() == KingCastle || type() == QueenCastle; }
+    // Knight, Bishop, Rook or Queen, only meaningful for promotions
+    constexpr ChessPiece promotionPiece() const { return (ChessPiece)(Knight + (type() & 3)); }
+
+    constexpr bool operator==(const BitMove& other) const { return data == other.data; }
+    constexpr bool operator!=(const BitMove& other) const { return data != other.data; }
+};
+static_assert(sizeof(BitMove) == 2, "moves are stored as 16 bits in the move lists, the search tables and the TT");
+
+// long algebraic notation as UCI and the search log use it, e.g. e2e4, e1g1 or e7e8n
+inline std::string moveToString(const BitMove& move) {
+    std::string text;
+    text += (char)('a' + (move.from() & 7));
+    text += (char)('1' + (move.from() >> 3));
+    text += (char)('a' + (move.to() & 7));
+    text += (char)('1' + (move.to() >> 3));
+    if (move.isPromotion())
+        text += "nbrq"[move.type() & 3];
+    return text;
+}
+
+// castling right bits
+enum CastlingRights {
+    WhiteKingSide = 0x01,
+    WhiteQueenSide = 0x02,
+    BlackKingSide = 0x04,
+    BlackQueenSide = 0x08
+};
+
+// GameStateData::flags, cleared when a move is pushed and put back as they were when it is popped
+enum StateFlags {
+    AttackMapsValid = 0x01     // _attacks and _attackBitBoard describe the current position
+};
+
+//
+// everything the move generator needs to know about one side, fixed at compile time
+// so the white and black generators each come out as straight line code
+//
+template <int Color>
+struct SideTraits {
+    static constexpr int Enemy = -Color;
+    static constexpr int Offset = (Color == WHITE) ? WHITE_PAWNS : BLACK_PAWNS;      // add to a WHITE_* index
+    static constexpr int EnemyOffset = (Color == WHITE) ? BLACK_PAWNS : WHITE_PAWNS;
+    static constexpr int PawnAttackIndex = (Color == WHITE) ? 0 : 1;                  // into PawnAttacks
+    static constexpr int Forward = (Color == WHITE) ? 8 : -8;
+    static constexpr int CaptureLeft = Forward - 1;                                   // towards the a file
+    static constexpr int CaptureRight = Forward + 1;                                  // towards the h file
+    static constexpr uint64_t DoublePushRank = (Color == WHITE) ? Rank3 : Rank6;     // where a single push has to land
+    static constexpr uint64_t PromotionRank = (Color == WHITE) ? Rank8 : Rank1;
+    static constexpr int KingStart = (Color == WHITE) ? 4 : 60;
+    static constexpr int KingSideRight = (Color == WHITE) ? WhiteKingSide : BlackKingSide;
+    static constexpr int QueenSideRight = (Color == WHITE) ? WhiteQueenSide : BlackQueenSide;
+};
+
+// shift left for positive amounts and right for negative ones, resolved at compile time
+template <int Shift>
+constexpr uint64_t shiftBy(uint64_t bits) {
+    if constexpr (Shift >= 0) {
+        return bits << Shift;
+    } else {
+        return bits >> -Shift;
+    }
+}
+
+// no legal chess position has more than 218 moves
+constexpr int MAX_MOVES = 256;
+
+//
+// fixed capacity move list that lives on the stack, so generating moves never touches the heap
+// scores run parallel to the moves for ordering in the search
+//
+struct MoveList {
+    BitMove moves[MAX_MOVES];
+    int scores[MAX_MOVES];
+    int count = 0;
+
+    inline void add(int from, int to, int type = QuietMove) {
+        assert(count < MAX_MOVES);
+        moves[count++] = BitMove(from, to, type);
+    }
+    inline void swap(int a, int b) {
+        std::swap(moves[a], moves[b]);
+        std::swap(scores[a], scores[b]);
+    }
+    void clear() { count = 0; }
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+    BitMove& operator[](int index) { return moves[index]; }
+    const BitMove& operator[](int index) const { return moves[index]; }
+    BitMove* begin() { return moves; }
+    BitMove* end() { return moves + count; }
+    const BitMove* begin() const { return moves; }
+    const BitMove* end() const { return moves + count; }
+};
+
+// bitboard index for each mailbox character, built at compile time so pushMove can stay inline
+struct BitboardLookupTable {
+    int index[128];
+    constexpr BitboardLookupTable() : index() {
+        index['P'] = WHITE_PAWNS;
+        index['N'] = WHITE_KNIGHTS;
+        index['B'] = WHITE_BISHOPS;
+        index['R'] = WHITE_ROOKS;
+        index['Q'] = WHITE_QUEENS;
+        index['K'] = WHITE_KING;
+        index['p'] = BLACK_PAWNS;
+        index['n'] = BLACK_KNIGHTS;
+        index['b'] = BLACK_BISHOPS;
+        index['r'] = BLACK_ROOKS;
+        index['q'] = BLACK_QUEENS;
+        index['k'] = BLACK_KING;
+        index['0'] = EMPTY_SQUARES;
+    }
+    constexpr int operator[](unsigned char piece) const { return index[piece]; }
+};
+inline constexpr BitboardLookupTable BitboardLookup;
+
+// rights that survive a move touching each square, so pushMove can just and them together
+struct CastlingMaskTable {
+    unsigned char mask[64];
+    constexpr CastlingMaskTable() : mask() {
+        for (int i = 0; i < 64; i++) { mask[i] = 0x0F; }
+        mask[0] = 0x0F & ~WhiteQueenSide;
+        mask[4] = 0x0F & ~(WhiteKingSide | WhiteQueenSide);
+        mask[7] = 0x0F & ~WhiteKingSide;
+        mask[56] = 0x0F & ~BlackQueenSide;
+        mask[60] = 0x0F & ~(BlackKingSide | BlackQueenSide);
+        mask[63] = 0x0F & ~BlackKingSide;
+    }
+    constexpr unsigned char operator[](int square) const { return mask[square]; }
+};
+inline constexpr CastlingMaskTable CastlingMask;
+
+//
+// zobrist keys for pieces (by bitboard index), side to move, castling rights and en passant file
+// generated at compile time with splitmix64 so every build and every thread sees the same keys
+// 'pawns' repeats the pawn keys and is zero for every other piece, so pushMove keeps the pawn key without branching
+//
+struct ZobristKeyTable {
+    uint64_t pieces[e_numBitboards][64];
+    uint64_t pawns[e_numBitboards][64];
+    uint64_t castling[16];
+    uint64_t enPassant[8];
+    uint64_t side;
+
+    static constexpr uint64_t splitmix64(uint64_t& seed) {
+        uint64_t z = (seed += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+    constexpr ZobristKeyTable() : pieces(), pawns(), castling(), enPassant(), side(0) {
+        uint64_t seed = 0x2545F4914F6CDD1DULL;
+        for (int piece = WHITE_PAWNS; piece <= BLACK_KING; piece++) {
+            if (piece == WHITE_ALL_PIECES)
+                continue;
+            for (int square = 0; square < 64; square++) {
+                pieces[piece][square] = splitmix64(seed);
+            }
+        }
+        // combined rights hash to the xor of the single rights, so changing one right is one xor
+        uint64_t single[4] = { splitmix64(seed), splitmix64(seed), splitmix64(seed), splitmix64(seed) };
+        for (int rights = 0; rights < 16; rights++) {
+            for (int bit = 0; bit < 4; bit++) {
+                if (rights & (1 << bit))
+                    castling[rights] ^= single[bit];
+            }
+        }
+        for (int file = 0; file < 8; file++) {
+            enPassant[file] = splitmix64(seed);
+        }
+        side = splitmix64(seed);
+        for (int square = 0; square < 64; square++) {
+            pawns[WHITE_PAWNS][square] = pieces[WHITE_PAWNS][square];
+            pawns[BLACK_PAWNS][square] = pieces[BLACK_PAWNS][square];
+        }
+    }
+};
+inline constexpr ZobristKeyTable ZobristKeys;
+
+//
+// packed score and phase weight for every bitboard index and square, built from PieceSquareTables.h
+// black entries are the mirrored white ones with the sign flipped, so the running sum is always from white's side
+// the other indices stay zero, so an empty square adds nothing
+//
+struct PieceSquareTable {
+    int score[e_numBitboards][64];
+    int phase[e_numBitboards];
+
+    constexpr PieceSquareTable() : score(), phase() {
+        using namespace PieceSquareData;
+        for (int piece = WHITE_PAWNS; piece <= WHITE_KING; piece++) {
+            for (int square = 0; square < 64; square++) {
+                // the tables start at a8, so a white piece reads its rank flipped and a black one reads it as is
+                const int white = square ^ 56;
+                score[piece][square] = makeScore(mgMaterial[piece] + mgTables[piece][white], egMaterial[piece] + egTables[piece][white]);
+                score[piece + BLACK_PAWNS][square] = -makeScore(mgMaterial[piece] + mgTables[piece][square], egMaterial[piece] + egTables[piece][square]);
+            }
+            phase[piece] = PieceSquareData::phase[piece];
+            phase[piece + BLACK_PAWNS] = PieceSquareData::phase[piece];
+        }
     }
 };
-#pragma pack(pop)
+inline constexpr PieceSquareTable PieceSquare;
 
 struct alignas(32) GameStateData {
     char state[64];                 // persisitent
     int flags;
     char color;                     // BLACK or WHITE
+    unsigned char castlingRights;   // CastlingRights bits
+    signed char enPassantSquare;    // square a pawn can capture onto, -1 if none
+    unsigned short halfmoveClock;   // plies since the last capture or pawn move, for the fifty move rule
+    uint64_t _zobristHash;          // position key, updated by pushMove and restored by popMove
+    uint64_t _pawnHash;             // the same over the pawns alone, for the pawn structure cache
+    int _psqScore;                  // packed midgame/endgame material and piece-square sum, white positive
+    unsigned char _phase;           // PieceSquareData::phase of everything on the board, MAX_PHASE at the start
+    BitBoard _bitboards[e_numBitboards]; // kept in sync with state by pushMove and popMove
 
     GameStateData() : flags(0)
-        , color(WHITE) {
+        , color(WHITE)
+        , castlingRights(0)
+        , enPassantSquare(-1)
+        , halfmoveClock(0)
+        , _zobristHash(0)
+        , _pawnHash(0)
+        , _psqScore(0)
+        , _phase(0) {
         std::memset(state, '0', sizeof(state));
     }
     GameStateData(const GameStateData&) = default;
     GameStateData& operator=(const GameStateData&) = default;
 };
 
+// what popMove needs to take a move back that can't be worked out from the move and the board
+struct UndoRecord {
+    uint64_t hash;
+    uint64_t pawnHash;
+    int psqScore;
+    BitMove move;
+    unsigned short halfmoveClock;
+    char captured;                  // mailbox character on the target square, '0' for quiet moves and en passant
+    unsigned char castlingRights;
+    signed char enPassantSquare;
+    unsigned char phase;
+    int flags;
+    // the attack maps of the position before the move, only copied when flags says they were built
+    // so popMove hands them back to the parent and the moves after the first don't build them again
+    BitBoard attacks[e_numBitboards];
+    uint64_t attackedTwice[2];
+    BitBoard attackBitBoard;
+};
+
+//
+// stack of undo records that never runs out: the first UNDO_INLINE records live inside the state,
+// so copying a state for a search thread or searching a normal line never allocates,
+// anything deeper spills over onto the heap
+//
+class UndoStack {
+public:
+    static constexpr int UNDO_INLINE = 128;
+
+    inline UndoRecord& push() {
+        if (_size < UNDO_INLINE)
+            return _inline[_size++];
+        _size++;
+        return _overflow.emplace_back();
+    }
+    inline const UndoRecord& back() const {
+        assert(_size > 0);
+        return (_size <= UNDO_INLINE) ? _inline[_size - 1] : _overflow.back();
+    }
+    inline void pop() {
+        assert(_size > 0);
+        if (_size-- > UNDO_INLINE)
+            _overflow.pop_back();
+    }
+    void clear() {
+        _size = 0;
+        _overflow.clear();
+    }
+    int size() const { return _size; }
+
+private:
+    UndoRecord _inline[UNDO_INLINE];
+    std::vector<UndoRecord> _overflow;
+    int _size = 0;
+};
+
 class GameState : public GameStateData {
 public:
-    GameStateData stateStack[MAX_DEPTH];
-    int stackPtr = 0;
+    UndoStack _undo;
 
-    uint64_t _zobristHash[2]; // when one hash value is made, the other is made as well because it's just a xor of the first by the color bit
-    BitBoard _bitboards[e_numBitboards];
+    // squares attacked by each piece type of each side, indexed like _bitboards, the ALL_PIECES entries
+    // hold everything a side attacks and _attackBitBoard what the side not to move attacks
+    // filled in by computeAttackMaps once per node and shared by the evaluation, SEE and check detection
+    BitBoard _attacks[e_numBitboards];
+    uint64_t _attackedTwice[2];     // squares white (0) and black (1) attack with more than one piece
     BitBoard _attackBitBoard;
 
-    GameState() : stackPtr(0) { }
+    // legality info for the position being generated, filled in by computeCheckAndPins
+    int _kingSquare = 0;
+    uint64_t _checkers = 0;
+    uint64_t _checkMask = ~0ULL;
+    uint64_t _pinned = 0;
+
+    // with a network attached pushMove keeps one accumulator per ply in step with the undo stack
+    const NnueNetwork* _network = nullptr;
+    std::vector<NnueAccumulator> _accumulators;
+    // endgame tables for probeBitbases, not owned
+    const Bitbases* _bitbases = nullptr;
+
+    GameState() { }
 
-    void init(const char* newState, char player);
+    // en passant squares nobody can capture onto are dropped so equal positions always hash the same
+    void init(const char* newState, char player, int castling = 0, int enPassant = -1, int halfmoves = 0);
+    // set up from a FEN string, either just the placement or the full string with side to move
+    void initFEN(const std::string& fen);
+    // full hash of the current position, pushMove keeps _zobristHash equal to this incrementally
+    uint64_t computeHash() const;
+    uint64_t computePawnHash() const;
+    // the same for _psqScore and _phase
+    int computePsqScore() const;
+    int computePhase() const;
+    // evaluate with the network from now on, nullptr goes back to the piece-square tables
+    // only the current position is computed, so moves pushed before attaching can't be popped past
+    void attachNetwork(const NnueNetwork* network);
+    const NnueAccumulator& accumulator() const { return _accumulators[_undo.size()]; }
+    // look positions up in these tables from now on, nullptr stops probing
+    void attachBitbases(const Bitbases* tables) { _bitbases = tables; }
+    // win, draw or loss for the side to move, false when nothing is attached or no table covers the position
+    bool probeBitbases(BitbaseResult& result) const { return _bitbases && _bitbases->probe(*this, result); }
 
     inline void pushMove(const BitMove& move) {
-        pushState();
-        unsigned char fromPiece = state[move.from];
-        state[move.from] = '0';
-        state[move.to] = fromPiece;
-        if (move.flags & KingCastle) {
-            state[move.to - 1] = state[move.to + 1];
-            state[move.to + 1] = '0';
-        } else if (move.flags & QueenCastle) {
-            state[move.to + 1] = state[move.to - 2];
-            state[move.to - 2] = '0';
-        } else if (move.flags & EnPassant) {
-            // check for color to determine which direction to capture
-            if (fromPiece == 'P') {
-                state[move.to - 8] = '0';
-            } else {
-                state[move.to + 8] = '0';
+        const int from = move.from();
+        const int to = move.to();
+        const int type = move.type();
+        const uint64_t fromMask = 1ULL << from;
+        const uint64_t toMask = 1ULL << to;
+        const unsigned char fromPiece = state[from];
+        const unsigned char toPiece = state[to];
+
+        UndoRecord& undo = _undo.push();
+        undo.hash = _zobristHash;
+        undo.pawnHash = _pawnHash;
+        undo.move = move;
+        undo.halfmoveClock = halfmoveClock;
+        undo.captured = toPiece;
+        undo.castlingRights = castlingRights;
+        undo.enPassantSquare = enPassantSquare;
+        undo.psqScore = _psqScore;
+        undo.phase = _phase;
+        undo.flags = flags;
+        if (flags & AttackMapsValid) {
+            std::copy(std::begin(_attacks), std::end(_attacks), undo.attacks);
+            undo.attackedTwice[0] = _attackedTwice[0];
+            undo.attackedTwice[1] = _attackedTwice[1];
+            undo.attackBitBoard = _attackBitBoard;
+        }
+
+        const int moverIdx = BitboardLookup[fromPiece];
+        const int moverAll = (color == WHITE) ? WHITE_ALL_PIECES : BLACK_ALL_PIECES;
+        const int enemyAll = (color == WHITE) ? BLACK_ALL_PIECES : WHITE_ALL_PIECES;
+
+        uint64_t hash = _zobristHash ^ ZobristKeys.side;
+        uint64_t pawnHash = _pawnHash ^ ZobristKeys.pawns[moverIdx][from] ^ ZobristKeys.pawns[moverIdx][to];
+        int psq = _psqScore + PieceSquare.score[moverIdx][to] - PieceSquare.score[moverIdx][from];
+        if (enPassantSquare >= 0) {
+            hash ^= ZobristKeys.enPassant[enPassantSquare & 7];
+            enPassantSquare = -1;
+        }
+        halfmoveClock = (moverIdx % BLACK_PAWNS == WHITE_PAWNS || toPiece != '0') ? 0 : halfmoveClock + 1;
+
+        // remove any captured piece first so the mover's bits never overlap it
+        if (toPiece != '0') {
+            _bitboards[BitboardLookup[toPiece]] ^= toMask;
+            _bitboards[enemyAll] ^= toMask;
+            hash ^= ZobristKeys.pieces[BitboardLookup[toPiece]][to];
+            pawnHash ^= ZobristKeys.pawns[BitboardLookup[toPiece]][to];
+            psq -= PieceSquare.score[BitboardLookup[toPiece]][to];
+            _phase -= PieceSquare.phase[BitboardLookup[toPiece]];
+        }
+        _bitboards[moverIdx] ^= fromMask | toMask;
+        _bitboards[moverAll] ^= fromMask | toMask;
+        hash ^= ZobristKeys.pieces[moverIdx][from] ^ ZobristKeys.pieces[moverIdx][to];
+
+        state[from] = '0';
+        state[to] = fromPiece;
+        if (type == KingCastle || type == QueenCastle) {
+            // the rook jumps to the square the king passed over
+            const int rookFrom = (type == KingCastle) ? to + 1 : to - 2;
+            const int rookTo = (type == KingCastle) ? to - 1 : to + 1;
+            const int rookIdx = moverIdx - WHITE_KING + WHITE_ROOKS;
+            const uint64_t rookMask = (1ULL << rookFrom) | (1ULL << rookTo);
+            _bitboards[rookIdx] ^= rookMask;
+            _bitboards[moverAll] ^= rookMask;
+            hash ^= ZobristKeys.pieces[rookIdx][rookFrom] ^ ZobristKeys.pieces[rookIdx][rookTo];
+            psq += PieceSquare.score[rookIdx][rookTo] - PieceSquare.score[rookIdx][rookFrom];
+            state[rookTo] = state[rookFrom];
+            state[rookFrom] = '0';
+        } else if (type == EnPassant) {
+            // the captured pawn sits behind the target square
+            const int captureSquare = (color == WHITE) ? to - 8 : to + 8;
+            const uint64_t captureMask = 1ULL << captureSquare;
+            _bitboards[(color == WHITE) ? BLACK_PAWNS : WHITE_PAWNS] ^= captureMask;
+            _bitboards[enemyAll] ^= captureMask;
+            hash ^= ZobristKeys.pieces[(color == WHITE) ? BLACK_PAWNS : WHITE_PAWNS][captureSquare];
+            pawnHash ^= ZobristKeys.pawns[(color == WHITE) ? BLACK_PAWNS : WHITE_PAWNS][captureSquare];
+            psq -= PieceSquare.score[(color == WHITE) ? BLACK_PAWNS : WHITE_PAWNS][captureSquare];
+            state[captureSquare] = '0';
+        } else if (type & IsPromotion) {
+            const int promotedIdx = moverIdx - WHITE_PAWNS + WHITE_KNIGHTS + (type & 3);
+            _bitboards[moverIdx] ^= toMask;
+            _bitboards[promotedIdx] ^= toMask;
+            hash ^= ZobristKeys.pieces[moverIdx][to] ^ ZobristKeys.pieces[promotedIdx][to];
+            pawnHash ^= ZobristKeys.pawns[moverIdx][to];
+            psq += PieceSquare.score[promotedIdx][to] - PieceSquare.score[moverIdx][to];
+            _phase += PieceSquare.phase[promotedIdx];
+            state[to] = ((color == WHITE) ? "NBRQ" : "nbrq")[type & 3];
+        } else if (type == DoublePawnPush) {
+            // only remember the en passant square when an enemy pawn is there to use it
+            const uint64_t adjacent = ((toMask << 1) & NotAFile) | ((toMask >> 1) & NotHFile);
+            if (adjacent & _bitboards[(color == WHITE) ? BLACK_PAWNS : WHITE_PAWNS].getData()) {
+                enPassantSquare = (from + to) / 2;
+                hash ^= ZobristKeys.enPassant[enPassantSquare & 7];
             }
-        } else if (move.flags & IsPromotion) {
-            state[move.to] = color == WHITE ? 'Q' : 'q';
         }
+        const unsigned char newRights = castlingRights & CastlingMask[from] & CastlingMask[to];
+        hash ^= ZobristKeys.castling[castlingRights] ^ ZobristKeys.castling[newRights];
+        castlingRights = newRights;
+        _zobristHash = hash;
+        _pawnHash = pawnHash;
+        _psqScore = psq;
+        _bitboards[OCCUPANCY] = _bitboards[WHITE_ALL_PIECES] | _bitboards[BLACK_ALL_PIECES];
+        _bitboards[EMPTY_SQUARES] = ~_bitboards[OCCUPANCY];
+        if (_network)
+            updateAccumulator(move, fromPiece, toPiece);
+
         // flip the color bit as it now becomes the other player's turn
         color = (color == WHITE) ? BLACK : WHITE;
         flags = 0; // invalidate all the flags
     }
 
-    inline void pushState() {
-        assert(stackPtr < MAX_DEPTH);
-        stateStack[stackPtr++] = static_cast<const GameStateData&>(*this);
-    }
-    inline void popState() {
-        assert(stackPtr > 0);
-        static_cast<GameStateData&>(*this) = stateStack[--stackPtr];
+    // takes back the last pushMove, moving the pieces back instead of copying the position
+    inline void popMove() {
+        const UndoRecord& undo = _undo.back();
+        color = (color == WHITE) ? BLACK : WHITE;
+        const int from = undo.move.from();
+        const int to = undo.move.to();
+        const int type = undo.move.type();
+        const uint64_t fromMask = 1ULL << from;
+        const uint64_t toMask = 1ULL << to;
+        const unsigned char movedPiece = state[to];
+        const int movedIdx = BitboardLookup[movedPiece];
+        const int moverAll = (color == WHITE) ? WHITE_ALL_PIECES : BLACK_ALL_PIECES;
+        const int enemyAll = (color == WHITE) ? BLACK_ALL_PIECES : WHITE_ALL_PIECES;
+
+        // a promoted piece goes back to being a pawn
+        const int pieceIdx = (type & IsPromotion) ? ((color == WHITE) ? WHITE_PAWNS : BLACK_PAWNS) : movedIdx;
+        _bitboards[movedIdx] ^= toMask;
+        _bitboards[pieceIdx] ^= fromMask;
+        _bitboards[moverAll] ^= fromMask | toMask;
+        state[from] = (type & IsPromotion) ? ((color == WHITE) ? 'P' : 'p') : movedPiece;
+        state[to] = undo.captured;
+        if (undo.captured != '0') {
+            _bitboards[BitboardLookup[(unsigned char)undo.captured]] ^= toMask;
+            _bitboards[enemyAll] ^= toMask;
+        }
+
+        if (type == KingCastle || type == QueenCastle) {
+            const int rookFrom = (type == KingCastle) ? to + 1 : to - 2;
+            const int rookTo = (type == KingCastle) ? to - 1 : to + 1;
+            const uint64_t rookMask = (1ULL << rookFrom) | (1ULL << rookTo);
+            _bitboards[movedIdx - WHITE_KING + WHITE_ROOKS] ^= rookMask;
+            _bitboards[moverAll] ^= rookMask;
+            state[rookFrom] = state[rookTo];
+            state[rookTo] = '0';
+        } else if (type == EnPassant) {
+            const int captureSquare = (color == WHITE) ? to - 8 : to + 8;
+            const uint64_t captureMask = 1ULL << captureSquare;
+            _bitboards[(color == WHITE) ? BLACK_PAWNS : WHITE_PAWNS] ^= captureMask;
+            _bitboards[enemyAll] ^= captureMask;
+            state[captureSquare] = (color == WHITE) ? 'p' : 'P';
+        }
+        _bitboards[OCCUPANCY] = _bitboards[WHITE_ALL_PIECES] | _bitboards[BLACK_ALL_PIECES];
+        _bitboards[EMPTY_SQUARES] = ~_bitboards[OCCUPANCY];
+
+        _zobristHash = undo.hash;
+        _pawnHash = undo.pawnHash;
+        halfmoveClock = undo.halfmoveClock;
+        castlingRights = undo.castlingRights;
+        enPassantSquare = undo.enPassantSquare;
+        _psqScore = undo.psqScore;
+        _phase = undo.phase;
+        flags = undo.flags;
+        if (flags & AttackMapsValid) {
+            std::copy(std::begin(undo.attacks), std::end(undo.attacks), _attacks);
+            _attackedTwice[0] = undo.attackedTwice[0];
+            _attackedTwice[1] = undo.attackedTwice[1];
+            _attackBitBoard = undo.attackBitBoard;
+        }
+        _undo.pop();
     }
 
-    std::vector<BitMove> generateAllMoves();
-    void shutdown();
+    // fills the list with every legal move for the side to move
+    void generateAllMoves(MoveList& moves);
+    // only the legal captures and promotions, for the quiescence search
+    void generateCaptures(MoveList& moves);
+    // the same for a side known at compile time, Color has to be the side to move
+    template <int Color> void generateAllMoves(MoveList& moves);
+    template <int Color> void generateCaptures(MoveList& moves);
+    // static exchange evaluation, the material the side to move wins or loses on the target square
+    // if both sides keep recapturing with their cheapest attacker
+    // with the attack maps built, a capture onto a square the opponent can't reach is answered without the swap
+    int see(const BitMove& move) const;
+    bool inCheck();
+    // attack maps for both sides, does nothing when they are already up to date
+    void computeAttackMaps();
 private:
+    template <int Color, bool CapturesOnly> void generateMoves(MoveList& moves);
     const BitBoard generatePawnAttacks(const BitBoard pawns, char color);
-    uint64_t generatePawnAttacksBitBoard(int square, char color);
     
-    void generateKnightMoves(std::vector<BitMove>& moves, BitBoard knightBoard, uint64_t occupancy);
-    void generateKingMoves(std::vector<BitMove>& moves, BitBoard kingBoard, uint64_t occupancy);
-    void generateRooksMoves(std::vector<BitMove>& moves, BitBoard bishopBoard, uint64_t occupancy, uint64_t friendlies);
-    void generateQueensMoves(std::vector<BitMove>& moves, BitBoard bishopBoard, uint64_t occupancy, uint64_t friendlies);
-
-    void generateBishopMoves(std::vector<BitMove>& moves, BitBoard bishopBoard, uint64_t occupancy, uint64_t friendlies);
-    void generatePawnMoveList(std::vector<BitMove>& moves, const BitBoard pawns, const BitBoard emptySquares, const BitBoard enemyPieces, char color);
-    void addPawnBitboardMovesToList(std::vector<BitMove>& moves, const BitBoard bitboard, const int shift);
+    void addMovesFrom(MoveList& moves, int fromSquare, uint64_t destinations, uint64_t occupancy);
+    template <int Color> void generateCastles(MoveList& moves, uint64_t occupancy, uint64_t enemyAttacks);
+    template <int Color, bool CapturesOnly> void generateEnPassant(MoveList& moves, uint64_t occupancy);
+    void generateKnightMoves(MoveList& moves, BitBoard knightBoard, uint64_t occupancy, uint64_t targets);
+    void generateKingMoves(MoveList& moves, BitBoard kingBoard, uint64_t occupancy, uint64_t targets);
+    void generateRooksMoves(MoveList& moves, BitBoard bishopBoard, uint64_t occupancy, uint64_t targets);
+    void generateQueensMoves(MoveList& moves, BitBoard bishopBoard, uint64_t occupancy, uint64_t targets);
+
+    void generateBishopMoves(MoveList& moves, BitBoard bishopBoard, uint64_t occupancy, uint64_t targets);
+    template <int Color, bool CapturesOnly> void generatePawnMoveList(MoveList& moves, const uint64_t pawns, const uint64_t emptySquares, const uint64_t enemyPieces, const uint64_t targets);
+    template <int Color, int Shift, bool CapturesOnly> void addPawnBitboardMovesToList(MoveList& moves, const uint64_t bitboard, const int type = QuietMove);
     bool isSquareAttacked(int square, char attackerColor, const BitBoard (&boards)[e_numBitboards]);
-    void filterOutIllegalMoves(std::vector<BitMove>& moves);
+    uint64_t attackersTo(int square, char attackerColor, uint64_t occupancy) const;
+    template <int AttackerColor> uint64_t attackedSquares(uint64_t occupancy) const;
+    template <int EnemyColor> void computeCheckAndPins();
+    uint64_t pinRay(int square) const;
+    void rebuildBitboards();
+    // the next ply's accumulator from this one, called by pushMove with the board already updated
+    void updateAccumulator(const BitMove& move, unsigned char moved, unsigned char captured);
+    void refreshAccumulator();
 
 };
@@ -3,8 +3,13 @@
 
 #include <stdint.h>
 
+//
+// board geometry for the attack tables: magic numbers, masks and the precomputed knight, king, pawn and line tables
+// everything here is constexpr and shared read only, the slider tables themselves are generated by attackgen
+//
+
 // Generate rook attacks for a given square and blocking pieces
-static inline uint64_t ratt(int sq, uint64_t block) {
+static constexpr uint64_t ratt(int sq, uint64_t block) {
     uint64_t result = 0ULL;
     int rk = sq / 8, fl = sq % 8, r, f;
 
@@ -32,7 +37,7 @@ static inline uint64_t ratt(int sq, uint64_t block) {
 }
 
 // Generate bishop attacks for a given square and blocking pieces
-static inline uint64_t batt(int sq, uint64_t block) {
+static constexpr uint64_t batt(int sq, uint64_t block) {
     uint64_t result = 0ULL;
     int rk = sq / 8, fl = sq % 8, r, f;
 
@@ -95,7 +100,7 @@ static inline uint64_t batt(int sq, uint64_t block) {
 #endif
 
 // Convert index to bitboard configuration
-static inline uint64_t indexToUint64(int index, int bits, uint64_t m) {
+static constexpr uint64_t indexToUint64(int index, int bits, uint64_t m) {
     uint64_t result = 0ULL;
     for (int i = 0; i < bits; i++) {
         uint64_t least_bit = m & -m;  // get least significant bit
@@ -128,7 +133,7 @@ static inline uint64_t indexToUint64(int index, int bits, uint64_t m) {
 #define BLACK_PAWN_ATTACKS(pawns) (SOUTH_EAST(pawns) | SOUTH_WEST(pawns))
 
 // Size of attack tables for each square
-const int RAttackSize[64] = {
+constexpr int RAttackSize[64] = {
   4096,
   2048,
   2048,
@@ -195,7 +200,7 @@ const int RAttackSize[64] = {
   4096,
 };
 
-const int BAttackSize[64] = {
+constexpr int BAttackSize[64] = {
   64,
   32,
   32,
@@ -262,12 +267,8 @@ const int BAttackSize[64] = {
   64,
 };
 
-// Attack lookup tables
-static uint64_t* RAttacks[64];
-static uint64_t* BAttacks[64];
-
 // Magic bitboard shift amounts
-const int RShifts[64] = {
+constexpr int RShifts[64] = {
   52,
   53,
   53,
@@ -334,7 +335,7 @@ const int RShifts[64] = {
   52,
 };
 
-const int BShifts[64] = {
+constexpr int BShifts[64] = {
   58,
   59,
   59,
@@ -402,7 +403,7 @@ const int BShifts[64] = {
 };
 
 // Magic numbers for rooks
-const uint64_t RMagic[64] = {
+constexpr uint64_t RMagic[64] = {
   0xa8002c000108020ULL,
   0x6c00049b0002001ULL,
   0x100200010090040ULL,
@@ -470,7 +471,7 @@ const uint64_t RMagic[64] = {
 };
 
 // Magic numbers for bishops
-const uint64_t BMagic[64] = {
+constexpr uint64_t BMagic[64] = {
   0x89a1121896040240ULL,
   0x2004844802002010ULL,
   0x2068080051921000ULL,
@@ -538,7 +539,7 @@ const uint64_t BMagic[64] = {
 };
 
 // Attack masks for each square
-const uint64_t RMasks[64] = {
+constexpr uint64_t RMasks[64] = {
   0x101010101017eULL,
   0x202020202027cULL,
   0x404040404047aULL,
@@ -605,7 +606,7 @@ const uint64_t RMasks[64] = {
   0x7e80808080808000ULL,
 };
 
-const uint64_t BMasks[64] = {
+constexpr uint64_t BMasks[64] = {
   0x40201008040200ULL,
   0x402010080400ULL,
   0x4020100a00ULL,
@@ -673,7 +674,7 @@ const uint64_t BMasks[64] = {
 };
 
 // Pre-calculated knight attack bitboards
-const uint64_t KnightAttacks[64] = {
+constexpr uint64_t KnightAttacks[64] = {
   0x20400ULL,
   0x50800ULL,
   0xa1100ULL,
@@ -741,7 +742,7 @@ const uint64_t KnightAttacks[64] = {
 };
 
 // Pre-calculated king attack bitboards
-const uint64_t KingAttacks[64] = {
+constexpr uint64_t KingAttacks[64] = {
   0x302ULL,
   0x705ULL,
   0xe0aULL,
@@ -808,66 +809,69 @@ const uint64_t KingAttacks[64] = {
   0x40c0000000000000ULL,
 };
 
-// Helper functions for move generation
-static inline uint64_t getRookAttacks(int square, uint64_t occupied) {
-    occupied &= RMasks[square];
-    occupied *= RMagic[square];
-    occupied >>= RShifts[square];
-    return RAttacks[square][occupied];
-}
-
-static inline uint64_t getBishopAttacks(int square, uint64_t occupied) {
-    occupied &= BMasks[square];
-    occupied *= BMagic[square];
-    occupied >>= BShifts[square];
-    return BAttacks[square][occupied];
-}
-
-static inline uint64_t getQueenAttacks(int square, uint64_t occupied) {
-    return getRookAttacks(square, occupied) | getBishopAttacks(square, occupied);
-}
-
-// Initialize magic bitboards
-void initMagicBitboards(void) {
-    int square, i;
-    uint64_t subset, index;
+// where each square's attacks start in the contiguous slider table, rook squares first and then bishop squares
+struct MagicEntry {
+    uint64_t mask;
+    uint64_t magic;
+    uint32_t offset;
+    uint32_t shift;
+};
 
-    // Initialize rook attack tables
-    for (square = 0; square < 64; square++) {
-        RAttacks[square] = new uint64_t[RAttackSize[square]];
-        uint64_t mask = RMasks[square];
-        int bits = countOnes(mask);
-        int n = 1 << bits;
+struct MagicEntryTable {
+    MagicEntry rook[64];
+    MagicEntry bishop[64];
+    uint32_t size;      // entries in the whole table
 
-        for (i = 0; i < n; i++) {
-            subset = indexToUint64(i, bits, mask);
-            index = (subset * RMagic[square]) >> RShifts[square];
-            RAttacks[square][index] = ratt(square, subset);
+    constexpr MagicEntryTable() : rook(), bishop(), size(0) {
+        for (int square = 0; square < 64; square++) {
+            rook[square] = { RMasks[square], RMagic[square], size, (uint32_t)RShifts[square] };
+            size += RAttackSize[square];
+        }
+        for (int square = 0; square < 64; square++) {
+            bishop[square] = { BMasks[square], BMagic[square], size, (uint32_t)BShifts[square] };
+            size += BAttackSize[square];
         }
     }
-
-    // Initialize bishop attack tables
-    for (square = 0; square < 64; square++) {
-        BAttacks[square] = new uint64_t[BAttackSize[square]];
-        uint64_t mask = BMasks[square];
-        int bits = countOnes(mask);
-        int n = 1 << bits;
-
-        for (i = 0; i < n; i++) {
-            subset = indexToUint64(i, bits, mask);
-            index = (subset * BMagic[square]) >> BShifts[square];
-            BAttacks[square][index] = batt(square, subset);
+};
+inline constexpr MagicEntryTable Magics;
+constexpr int SLIDER_TABLE_SIZE = 107648;
+static_assert(Magics.size == SLIDER_TABLE_SIZE, "slider table size doesn't match the attack sizes");
+
+// pawn attacks by color (0 white, 1 black) and square
+struct PawnAttackTable {
+    uint64_t attacks[2][64];
+    constexpr PawnAttackTable() : attacks() {
+        for (int square = 0; square < 64; square++) {
+            const uint64_t pawn = 1ULL << square;
+            attacks[0][square] = WHITE_PAWN_ATTACKS(pawn);
+            attacks[1][square] = BLACK_PAWN_ATTACKS(pawn);
         }
     }
-}
-
-// Cleanup magic bitboard tables
-void cleanupMagicBitboards(void) {
-    int square;
-    for (square = 0; square < 64; square++) {
-        delete[] RAttacks[square];
-        delete[] BAttacks[square];
+    constexpr const uint64_t* operator[](int color) const { return attacks[color]; }
+};
+inline constexpr PawnAttackTable PawnAttacks;
+
+// masks between two squares on a shared rank, file or diagonal, zero when they aren't aligned
+struct LineMaskTable {
+    uint64_t between[64][64];   // squares strictly between the two
+    uint64_t line[64][64];      // the whole line through both, edge to edge
+    constexpr LineMaskTable() : between(), line() {
+        for (int from = 0; from < 64; from++) {
+            for (int to = 0; to < 64; to++) {
+                if (from == to)
+                    continue;
+                const uint64_t ends = (1ULL << from) | (1ULL << to);
+                if (ratt(from, 0) & (1ULL << to)) {
+                    line[from][to] = (ratt(from, 0) & ratt(to, 0)) | ends;
+                    between[from][to] = ratt(from, 1ULL << to) & ratt(to, 1ULL << from);
+                } else if (batt(from, 0) & (1ULL << to)) {
+                    line[from][to] = (batt(from, 0) & batt(to, 0)) | ends;
+                    between[from][to] = batt(from, 1ULL << to) & batt(to, 1ULL << from);
+                }
+            }
+        }
     }
-}
+};
+inline constexpr LineMaskTable LineMasks;
 
 #endif // MAGIC_BITBOARDS_H
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+//
+// a whole file mapped read only into memory, for data that is too big to read in at startup
+// the pages are only loaded when they are first touched and stay shared between processes
+//
+class MappedFile {
+public:
+    MappedFile() { }
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // false if the file can't be opened or is empty, anything mapped before is closed either way
+    bool open(const std::string& path);
+    void close();
+
+    bool isOpen() const { return _data != nullptr; }
+    const unsigned char* data() const { return _data; }
+    size_t size() const { return _size; }
+
+private:
+    const unsigned char* _data = nullptr;
+    size_t _size = 0;
+#if defined(_WIN32)
+    void* _file = nullptr;
+    void* _mapping = nullptr;
+#endif
+};
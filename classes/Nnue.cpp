@@ -0,0 +1,306 @@
+#include <algorithm>
+#include <cstring>
+#include "Nnue.h"
+#include "GameState.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define NNUE_X86
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__) && !defined(_MSC_VER)
+    #define NNUE_TARGET_AVX2 __attribute__((target("avx2")))
+    #define NNUE_TARGET_SSE41 __attribute__((target("sse4.1")))
+#else
+    #define NNUE_TARGET_AVX2
+    #define NNUE_TARGET_SSE41
+#endif
+
+//
+// the three things the network does that are worth vectorizing, one set per instruction set
+//   accumulate  out = in + the added weight rows - the removed ones, NNUE_HALF int16 lanes
+//   transform   both halves of the accumulator clipped to 0..127 and packed into bytes, side to move first
+//   affine      out = biases + weights * in, with unsigned 8 bit inputs and signed 8 bit weights
+//
+struct NnueKernels {
+    const char* name;
+    void (*accumulate)(int16_t* out, const int16_t* in, const int16_t* const* added, int addedCount,
+                       const int16_t* const* removed, int removedCount);
+    void (*transform)(uint8_t* out, const int16_t* us, const int16_t* them);
+    void (*affine)(int32_t* out, const uint8_t* in, int inputs, const int8_t* weights, const int32_t* biases, int outputs);
+};
+
+static void accumulateScalar(int16_t* out, const int16_t* in, const int16_t* const* added, int addedCount,
+                             const int16_t* const* removed, int removedCount) {
+    for (int i = 0; i < NNUE_HALF; i++) {
+        int16_t value = in[i];
+        for (int j = 0; j < addedCount; j++) {
+            value += added[j][i];
+        }
+        for (int j = 0; j < removedCount; j++) {
+            value -= removed[j][i];
+        }
+        out[i] = value;
+    }
+}
+
+static void transformScalar(uint8_t* out, const int16_t* us, const int16_t* them) {
+    for (int i = 0; i < NNUE_HALF; i++) {
+        out[i] = (uint8_t)std::clamp<int>(us[i], 0, 127);
+        out[NNUE_HALF + i] = (uint8_t)std::clamp<int>(them[i], 0, 127);
+    }
+}
+
+static void affineScalar(int32_t* out, const uint8_t* in, int inputs, const int8_t* weights, const int32_t* biases, int outputs) {
+    for (int o = 0; o < outputs; o++) {
+        const int8_t* row = weights + o * inputs;
+        int32_t sum = biases[o];
+        for (int i = 0; i < inputs; i++) {
+            sum += in[i] * row[i];
+        }
+        out[o] = sum;
+    }
+}
+
+static const NnueKernels ScalarKernels = { "scalar", accumulateScalar, transformScalar, affineScalar };
+
+#if defined(NNUE_X86)
+
+NNUE_TARGET_SSE41 static void accumulateSse41(int16_t* out, const int16_t* in, const int16_t* const* added, int addedCount,
+                                               const int16_t* const* removed, int removedCount) {
+    for (int i = 0; i < NNUE_HALF; i += 8) {
+        __m128i value = _mm_loadu_si128((const __m128i*)(in + i));
+        for (int j = 0; j < addedCount; j++) {
+            value = _mm_add_epi16(value, _mm_loadu_si128((const __m128i*)(added[j] + i)));
+        }
+        for (int j = 0; j < removedCount; j++) {
+            value = _mm_sub_epi16(value, _mm_loadu_si128((const __m128i*)(removed[j] + i)));
+        }
+        _mm_storeu_si128((__m128i*)(out + i), value);
+    }
+}
+
+NNUE_TARGET_SSE41 static void transformSse41(uint8_t* out, const int16_t* us, const int16_t* them) {
+    const __m128i zero = _mm_setzero_si128();
+    const int16_t* halves[2] = { us, them };
+    for (int half = 0; half < 2; half++) {
+        for (int i = 0; i < NNUE_HALF; i += 16) {
+            // saturate to -128..127, then drop the negatives
+            const __m128i packed = _mm_packs_epi16(_mm_loadu_si128((const __m128i*)(halves[half] + i)),
+                                                   _mm_loadu_si128((const __m128i*)(halves[half] + i + 8)));
+            _mm_storeu_si128((__m128i*)(out + half * NNUE_HALF + i), _mm_max_epi8(packed, zero));
+        }
+    }
+}
+
+NNUE_TARGET_SSE41 static void affineSse41(int32_t* out, const uint8_t* in, int inputs, const int8_t* weights, const int32_t* biases, int outputs) {
+    const __m128i ones = _mm_set1_epi16(1);
+    for (int o = 0; o < outputs; o++) {
+        const int8_t* row = weights + o * inputs;
+        __m128i sum = _mm_setzero_si128();
+        for (int i = 0; i < inputs; i += 16) {
+            // byte products summed in pairs, then in fours into 32 bit lanes
+            const __m128i products = _mm_maddubs_epi16(_mm_loadu_si128((const __m128i*)(in + i)), _mm_loadu_si128((const __m128i*)(row + i)));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(products, ones));
+        }
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+        out[o] = biases[o] + _mm_cvtsi128_si32(sum);
+    }
+}
+
+NNUE_TARGET_AVX2 static void accumulateAvx2(int16_t* out, const int16_t* in, const int16_t* const* added, int addedCount,
+                                             const int16_t* const* removed, int removedCount) {
+    for (int i = 0; i < NNUE_HALF; i += 16) {
+        __m256i value = _mm256_loadu_si256((const __m256i*)(in + i));
+        for (int j = 0; j < addedCount; j++) {
+            value = _mm256_add_epi16(value, _mm256_loadu_si256((const __m256i*)(added[j] + i)));
+        }
+        for (int j = 0; j < removedCount; j++) {
+            value = _mm256_sub_epi16(value, _mm256_loadu_si256((const __m256i*)(removed[j] + i)));
+        }
+        _mm256_storeu_si256((__m256i*)(out + i), value);
+    }
+}
+
+NNUE_TARGET_AVX2 static void transformAvx2(uint8_t* out, const int16_t* us, const int16_t* them) {
+    const __m256i zero = _mm256_setzero_si256();
+    const int16_t* halves[2] = { us, them };
+    for (int half = 0; half < 2; half++) {
+        for (int i = 0; i < NNUE_HALF; i += 32) {
+            // the pack works within 128 bit lanes, the permute puts the quarters back in order
+            const __m256i packed = _mm256_packs_epi16(_mm256_loadu_si256((const __m256i*)(halves[half] + i)),
+                                                      _mm256_loadu_si256((const __m256i*)(halves[half] + i + 16)));
+            const __m256i ordered = _mm256_permute4x64_epi64(_mm256_max_epi8(packed, zero), 0xD8);
+            _mm256_storeu_si256((__m256i*)(out + half * NNUE_HALF + i), ordered);
+        }
+    }
+}
+
+NNUE_TARGET_AVX2 static void affineAvx2(int32_t* out, const uint8_t* in, int inputs, const int8_t* weights, const int32_t* biases, int outputs) {
+    const __m256i ones = _mm256_set1_epi16(1);
+    for (int o = 0; o < outputs; o++) {
+        const int8_t* row = weights + o * inputs;
+        __m256i sum = _mm256_setzero_si256();
+        for (int i = 0; i < inputs; i += 32) {
+            const __m256i products = _mm256_maddubs_epi16(_mm256_loadu_si256((const __m256i*)(in + i)), _mm256_loadu_si256((const __m256i*)(row + i)));
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(products, ones));
+        }
+        __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4E));
+        half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xB1));
+        out[o] = biases[o] + _mm_cvtsi128_si32(half);
+    }
+}
+
+static const NnueKernels Sse41Kernels = { "sse4.1", accumulateSse41, transformSse41, affineSse41 };
+static const NnueKernels Avx2Kernels = { "avx2", accumulateAvx2, transformAvx2, affineAvx2 };
+
+#endif
+
+static const NnueKernels* bestKernels() {
+#if defined(NNUE_X86) && defined(__GNUC__) && !defined(_MSC_VER)
+    if (__builtin_cpu_supports("avx2"))
+        return &Avx2Kernels;
+    if (__builtin_cpu_supports("sse4.1"))
+        return &Sse41Kernels;
+#elif defined(NNUE_X86) && defined(__AVX2__)
+    return &Avx2Kernels;
+#endif
+    return &ScalarKernels;
+}
+
+// hidden layer sums back down to 0..127 bytes for the next layer
+static void clipLayer(uint8_t* out, const int32_t* in, int count) {
+    for (int i = 0; i < count; i++) {
+        out[i] = (uint8_t)std::clamp(in[i] >> NNUE_WEIGHT_SHIFT, 0, 127);
+    }
+}
+
+// black's point of view is the board flipped, with its own pieces counted as "ours"
+static inline int featureIndex(int perspective, int kingSquare, int piece, int square) {
+    const int pieceColor = piece >= BLACK_PAWNS ? 1 : 0;
+    const int type = piece - pieceColor * BLACK_PAWNS;
+    const int flip = perspective ? 56 : 0;
+    const int kind = (pieceColor == perspective) ? type : type + 5;
+    return ((kingSquare ^ flip) * 10 + kind) * 64 + (square ^ flip);
+}
+
+static inline int kingSquareOf(int perspective, const GameState& state) {
+    const BitBoard& king = state._bitboards[perspective ? BLACK_KING : WHITE_KING];
+    return king.getData() ? king.firstBit() : 0;
+}
+
+static constexpr size_t NNUE_HEADER_SIZE = 64;
+static constexpr size_t blockSize(size_t bytes) {
+    return (bytes + 63) & ~(size_t)63;
+}
+
+NnueNetwork::NnueNetwork() : _kernels(bestKernels()) {
+}
+
+bool NnueNetwork::load(const std::string& path) {
+    unload();
+    if (!_file.open(path))
+        return false;
+
+    const size_t transformerBiases = blockSize(sizeof(int16_t) * NNUE_HALF);
+    const size_t transformerWeights = blockSize(sizeof(int16_t) * NNUE_HALF * (size_t)NNUE_INPUTS);
+    const size_t hidden1Biases = blockSize(sizeof(int32_t) * NNUE_HIDDEN1);
+    const size_t hidden1Weights = blockSize(NNUE_HIDDEN1 * 2 * NNUE_HALF);
+    const size_t hidden2Biases = blockSize(sizeof(int32_t) * NNUE_HIDDEN2);
+    const size_t hidden2Weights = blockSize(NNUE_HIDDEN2 * NNUE_HIDDEN1);
+    const size_t outputBias = blockSize(sizeof(int32_t));
+    const size_t outputWeights = blockSize(NNUE_HIDDEN2);
+    const size_t expected = NNUE_HEADER_SIZE + transformerBiases + transformerWeights + hidden1Biases + hidden1Weights +
+                            hidden2Biases + hidden2Weights + outputBias + outputWeights;
+
+    const unsigned char* data = _file.data();
+    int32_t shape[4];
+    std::memcpy(shape, data + 8, sizeof(shape));
+    if (_file.size() != expected || std::memcmp(data, "CHESSNN1", 8) != 0 || shape[0] != NNUE_INPUTS ||
+        shape[1] != NNUE_HALF || shape[2] != NNUE_HIDDEN1 || shape[3] != NNUE_HIDDEN2) {
+        unload();
+        return false;
+    }
+
+    // the mapping starts on a page boundary and every block is padded, so the weights are all 64 byte aligned
+    size_t offset = NNUE_HEADER_SIZE;
+    _transformerBiases = (const int16_t*)(data + offset);
+    offset += transformerBiases;
+    _transformerWeights = (const int16_t*)(data + offset);
+    offset += transformerWeights;
+    _hidden1Biases = (const int32_t*)(data + offset);
+    offset += hidden1Biases;
+    _hidden1Weights = (const int8_t*)(data + offset);
+    offset += hidden1Weights;
+    _hidden2Biases = (const int32_t*)(data + offset);
+    offset += hidden2Biases;
+    _hidden2Weights = (const int8_t*)(data + offset);
+    offset += hidden2Weights;
+    _outputBias = (const int32_t*)(data + offset);
+    offset += outputBias;
+    _outputWeights = (const int8_t*)(data + offset);
+    return true;
+}
+
+void NnueNetwork::unload() {
+    _file.close();
+    _transformerBiases = nullptr;
+    _transformerWeights = nullptr;
+    _hidden1Biases = nullptr;
+    _hidden1Weights = nullptr;
+    _hidden2Biases = nullptr;
+    _hidden2Weights = nullptr;
+    _outputBias = nullptr;
+    _outputWeights = nullptr;
+}
+
+const char* NnueNetwork::simdName() const {
+    return _kernels->name;
+}
+
+void NnueNetwork::refresh(NnueAccumulator& accumulator, int perspective, const GameState& state) const {
+    const int kingSquare = kingSquareOf(perspective, state);
+    const int16_t* rows[32];
+    int count = 0;
+    for (int piece = WHITE_PAWNS; piece <= BLACK_QUEENS; piece++) {
+        if (piece == WHITE_KING || piece == WHITE_ALL_PIECES)
+            continue;
+        state._bitboards[piece].forEachBit([&](int square) {
+            if (count < 32)
+                rows[count++] = _transformerWeights + (size_t)featureIndex(perspective, kingSquare, piece, square) * NNUE_HALF;
+        });
+    }
+    _kernels->accumulate(accumulator.values[perspective], _transformerBiases, rows, count, nullptr, 0);
+}
+
+void NnueNetwork::update(const NnueAccumulator& previous, NnueAccumulator& current, int perspective,
+                         const GameState& state, const NnueDelta& delta) const {
+    const int kingSquare = kingSquareOf(perspective, state);
+    const int16_t* added[2];
+    const int16_t* removed[2];
+    for (int i = 0; i < delta.addedCount; i++) {
+        added[i] = _transformerWeights + (size_t)featureIndex(perspective, kingSquare, delta.added[i].piece, delta.added[i].square) * NNUE_HALF;
+    }
+    for (int i = 0; i < delta.removedCount; i++) {
+        removed[i] = _transformerWeights + (size_t)featureIndex(perspective, kingSquare, delta.removed[i].piece, delta.removed[i].square) * NNUE_HALF;
+    }
+    _kernels->accumulate(current.values[perspective], previous.values[perspective], added, delta.addedCount, removed, delta.removedCount);
+}
+
+int NnueNetwork::evaluate(const NnueAccumulator& accumulator, int sideToMove) const {
+    alignas(64) uint8_t input[2 * NNUE_HALF];
+    alignas(64) int32_t sums[NNUE_HIDDEN1];
+    alignas(64) uint8_t hidden1[NNUE_HIDDEN1];
+    alignas(64) uint8_t hidden2[NNUE_HIDDEN2];
+    int32_t output;
+
+    _kernels->transform(input, accumulator.values[sideToMove], accumulator.values[sideToMove ^ 1]);
+    _kernels->affine(sums, input, 2 * NNUE_HALF, _hidden1Weights, _hidden1Biases, NNUE_HIDDEN1);
+    clipLayer(hidden1, sums, NNUE_HIDDEN1);
+    _kernels->affine(sums, hidden1, NNUE_HIDDEN1, _hidden2Weights, _hidden2Biases, NNUE_HIDDEN2);
+    clipLayer(hidden2, sums, NNUE_HIDDEN2);
+    _kernels->affine(&output, hidden2, NNUE_HIDDEN2, _outputWeights, _outputBias, 1);
+    return output / NNUE_OUTPUT_SCALE;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "MappedFile.h"
+
+class GameState;
+
+//
+// efficiently updatable neural network evaluation, HalfKP style
+// every input is a (own king square, piece, square) triple for one side's point of view, kings themselves aren't inputs,
+// so a move only turns a handful of inputs on and off and the first layer is kept up to date incrementally:
+// GameState::pushMove adds and subtracts the weight rows of the changed inputs, popMove just steps back a ply
+//
+//   inputs  2 x 40960 -> accumulator 2 x 256 (int16), side to move first
+//   clipped to 0..127 -> 32 (int8 weights) -> clipped -> 32 (int8 weights) -> clipped -> 1
+//
+// the dense layers run on AVX2, SSE4.1 or plain C++, whichever the CPU supports, picked when the network is loaded
+//
+constexpr int NNUE_KING_SQUARES = 64;
+constexpr int NNUE_PIECE_SQUARES = 10 * 64;    // pawn to queen of both colors on every square
+constexpr int NNUE_INPUTS = NNUE_KING_SQUARES * NNUE_PIECE_SQUARES;
+constexpr int NNUE_HALF = 256;                 // accumulator width for one point of view
+constexpr int NNUE_HIDDEN1 = 32;
+constexpr int NNUE_HIDDEN2 = 32;
+// hidden layer sums are shifted down by this many bits before clipping, the output is divided into centipawns
+constexpr int NNUE_WEIGHT_SHIFT = 6;
+constexpr int NNUE_OUTPUT_SCALE = 16;
+
+// first layer output for both points of view, [0] is white's and [1] black's
+struct alignas(64) NnueAccumulator {
+    int16_t values[2][NNUE_HALF];
+};
+
+// the non-king pieces a move takes off and puts on the board, by bitboard index and square
+struct NnueDelta {
+    struct Change {
+        int piece;
+        int square;
+    };
+    Change removed[2];
+    Change added[2];
+    int removedCount = 0;
+    int addedCount = 0;
+
+    void remove(int piece, int square) { removed[removedCount++] = { piece, square }; }
+    void add(int piece, int square) { added[addedCount++] = { piece, square }; }
+};
+
+struct NnueKernels;
+
+//
+// the network file is mapped straight into memory and used in place, little endian:
+//   64 byte header: "CHESSNN1", then int32 inputs, accumulator width, hidden1 and hidden2 matching the constants above
+//   int16 transformer biases[256], int16 transformer weights[40960][256]
+//   int32 hidden1 biases[32], int8 hidden1 weights[32][512]
+//   int32 hidden2 biases[32], int8 hidden2 weights[32][32]
+//   int32 output bias, int8 output weights[32]
+// every block starts on a 64 byte boundary, zero padded
+//
+class NnueNetwork {
+public:
+    NnueNetwork();
+
+    // false if the file is missing or isn't a network of this shape, the old network is dropped either way
+    bool load(const std::string& path);
+    void unload();
+    bool isLoaded() const { return _file.isOpen(); }
+    // instruction set the dense layers run on
+    const char* simdName() const;
+
+    // one point of view from scratch, needed for a new position and whenever that side's king moves
+    void refresh(NnueAccumulator& accumulator, int perspective, const GameState& state) const;
+    // one point of view of 'previous' with the move's changes applied, written to 'current'
+    void update(const NnueAccumulator& previous, NnueAccumulator& current, int perspective,
+                const GameState& state, const NnueDelta& delta) const;
+    // centipawns for the side to move, 0 for white and 1 for black
+    int evaluate(const NnueAccumulator& accumulator, int sideToMove) const;
+
+private:
+    MappedFile _file;
+    const NnueKernels* _kernels;
+    const int16_t* _transformerBiases = nullptr;
+    const int16_t* _transformerWeights = nullptr;
+    const int32_t* _hidden1Biases = nullptr;
+    const int8_t* _hidden1Weights = nullptr;
+    const int32_t* _hidden2Biases = nullptr;
+    const int8_t* _hidden2Weights = nullptr;
+    const int32_t* _outputBias = nullptr;
+    const int8_t* _outputWeights = nullptr;
+};
@@ -0,0 +1,102 @@
+#include "OpeningBook.h"
+
+static inline uint64_t readBigEndian(const unsigned char* data, int bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; i++) {
+        value = (value << 8) | data[i];
+    }
+    return value;
+}
+
+bool OpeningBook::load(const std::string& path) {
+    if (!_file.open(path))
+        return false;
+    if (_file.size() % ENTRY_SIZE != 0) {
+        unload();
+        return false;
+    }
+    return true;
+}
+
+uint64_t OpeningBook::key(const GameState& state) {
+    uint64_t key = 0;
+    for (int piece = WHITE_PAWNS; piece <= WHITE_KING; piece++) {
+        // the kinds go black pawn, white pawn, black knight and so on
+        const int white = 2 * piece + 1;
+        const int black = 2 * piece;
+        state._bitboards[piece].forEachBit([&](int square) {
+            key ^= BookKeys.random[BookKeyTable::PIECES + 64 * white + square];
+        });
+        state._bitboards[piece + BLACK_PAWNS].forEachBit([&](int square) {
+            key ^= BookKeys.random[BookKeyTable::PIECES + 64 * black + square];
+        });
+    }
+    static const int rights[4] = { WhiteKingSide, WhiteQueenSide, BlackKingSide, BlackQueenSide };
+    for (int i = 0; i < 4; i++) {
+        if (state.castlingRights & rights[i])
+            key ^= BookKeys.random[BookKeyTable::CASTLING + i];
+    }
+    // the state only keeps an en passant square a pawn can actually capture onto, so that's the only time it's hashed
+    if (state.enPassantSquare >= 0)
+        key ^= BookKeys.random[BookKeyTable::EN_PASSANT + (state.enPassantSquare & 7)];
+    if (state.color == WHITE)
+        key ^= BookKeys.random[BookKeyTable::TURN];
+    return key;
+}
+
+uint16_t OpeningBook::encodeMove(const BitMove& move) {
+    int to = move.to();
+    if (move.type() == KingCastle)
+        to = move.from() + 3;
+    else if (move.type() == QueenCastle)
+        to = move.from() - 4;
+    const int promotion = move.isPromotion() ? (move.type() & 3) + 1 : 0;
+    return (uint16_t)(to | (move.from() << 6) | (promotion << 12));
+}
+
+BitMove OpeningBook::probe(GameState& state, uint64_t random) const {
+    if (!isLoaded())
+        return BitMove();
+    const uint64_t target = key(state);
+    const unsigned char* data = _file.data();
+    const size_t count = entryCount();
+
+    // first entry with this key
+    size_t low = 0;
+    size_t high = count;
+    while (low < high) {
+        const size_t middle = low + (high - low) / 2;
+        if (readBigEndian(data + middle * ENTRY_SIZE, 8) < target)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    uint32_t total = 0;
+    size_t end = low;
+    for (; end < count && readBigEndian(data + end * ENTRY_SIZE, 8) == target; end++) {
+        total += (uint32_t)readBigEndian(data + end * ENTRY_SIZE + 10, 2);
+    }
+    // zero weights mean the book knows the move but doesn't want it played
+    if (total == 0)
+        return BitMove();
+
+    uint32_t pick = (uint32_t)(random % total);
+    uint16_t chosen = 0;
+    for (size_t i = low; i < end; i++) {
+        const uint32_t weight = (uint32_t)readBigEndian(data + i * ENTRY_SIZE + 10, 2);
+        if (pick < weight) {
+            chosen = (uint16_t)readBigEndian(data + i * ENTRY_SIZE + 8, 2);
+            break;
+        }
+        pick -= weight;
+    }
+
+    // a book entry only counts when it is legal here, a key collision would give some other position's move
+    MoveList moves;
+    state.generateAllMoves(moves);
+    for (const BitMove& move : moves) {
+        if (encodeMove(move) == chosen)
+            return move;
+    }
+    return BitMove();
+}
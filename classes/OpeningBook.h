@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "MappedFile.h"
+#include "GameState.h"
+
+//
+// random numbers for book keys: 768 for the pieces (64 per kind, black pawn, white pawn, black knight ...
+// white king, square a1 first), then the four castling rights, the eight en passant files and the side to move
+// they're this engine's own numbers from splitmix64 like ZobristKeys, so the books bookgen writes read back
+// here but a book hashed by another tool never matches a position
+//
+struct BookKeyTable {
+    static constexpr int PIECES = 0;
+    static constexpr int CASTLING = 768;
+    static constexpr int EN_PASSANT = 772;
+    static constexpr int TURN = 780;
+    uint64_t random[781];
+
+    constexpr BookKeyTable() : random() {
+        uint64_t seed = 0x3243F6A8885A308DULL;
+        for (int i = 0; i < 781; i++) {
+            random[i] = ZobristKeyTable::splitmix64(seed);
+        }
+    }
+};
+inline constexpr BookKeyTable BookKeys;
+
+//
+// opening book written by bookgen, mapped read only and searched in place
+// the file is a list of 16 byte big endian entries sorted by key: uint64 key, uint16 move, uint16 weight, uint32 learn
+// moves hold the to square in bits 0-5, the from square in bits 6-11 and the promotion (1 knight .. 4 queen)
+// in bits 12-14, castling is written as the king taking its own rook
+//
+class OpeningBook {
+public:
+    static constexpr size_t ENTRY_SIZE = 16;
+
+    // false if the file is missing or isn't a whole number of entries, the old book is closed either way
+    bool load(const std::string& path);
+    void unload() { _file.close(); }
+    bool isLoaded() const { return _file.isOpen(); }
+    size_t entryCount() const { return _file.size() / ENTRY_SIZE; }
+
+    // one of the book moves for the position, picked by weight with 'random', an empty move out of book
+    // only binary searches the mapped file and generates the legal moves on the stack, nothing is allocated
+    BitMove probe(GameState& state, uint64_t random) const;
+
+    static uint64_t key(const GameState& state);
+    static uint16_t encodeMove(const BitMove& move);
+
+private:
+    MappedFile _file;
+};
@@ -0,0 +1,46 @@
+#include "PawnHashTable.h"
+#include "MagicBitboards.h"
+#include "PieceSquareTables.h"
+
+// packed midgame/endgame penalties and bonuses, from the pawn owner's point of view
+constexpr int DOUBLED_PAWN = makeScore(-10, -25);      // for each pawn with another of its own ahead on the file
+constexpr int ISOLATED_PAWN = makeScore(-10, -15);     // no pawns of its own on the neighbouring files
+constexpr int BACKWARD_PAWN = makeScore(-8, -12);      // can't be supported and the square ahead is covered by an enemy pawn
+// passed pawns by rank counted from the owner's side
+constexpr int PASSED_PAWN[8] = {
+    makeScore(0, 0), makeScore(5, 10), makeScore(10, 20), makeScore(15, 35),
+    makeScore(25, 60), makeScore(45, 100), makeScore(70, 150), makeScore(0, 0)
+};
+
+void PawnHashTable::evaluate(const GameState& state, PawnEntry& entry) {
+    int score = 0;
+    for (int color = 0; color < 2; color++) {
+        const uint64_t own = state._bitboards[color == 0 ? WHITE_PAWNS : BLACK_PAWNS].getData();
+        const uint64_t enemy = state._bitboards[color == 0 ? BLACK_PAWNS : WHITE_PAWNS].getData();
+        uint64_t passed = 0;
+        int sideScore = 0;
+        BitBoard(own).forEachBit([&](int square) {
+            const int rank = color == 0 ? square >> 3 : 7 - (square >> 3);
+            const bool isolated = (own & PawnMasks.adjacentFiles[square & 7]) == 0;
+            if (own & PawnMasks.front[color][square]) {
+                sideScore += DOUBLED_PAWN;
+            }
+            if (isolated) {
+                sideScore += ISOLATED_PAWN;
+            }
+            if ((enemy & PawnMasks.passed[color][square]) == 0 && (own & PawnMasks.front[color][square]) == 0) {
+                passed |= 1ULL << square;
+                sideScore += PASSED_PAWN[rank];
+            } else if (!isolated && (own & PawnMasks.support[color][square]) == 0) {
+                const int stop = color == 0 ? square + 8 : square - 8;
+                if (PawnAttacks[color][stop] & enemy) {
+                    sideScore += BACKWARD_PAWN;
+                }
+            }
+        });
+        entry.passed[color] = passed;
+        score += color == 0 ? sideScore : -sideScore;
+    }
+    entry.key = state._pawnHash;
+    entry.score = score;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "GameState.h"
+
+// pawn structure masks by color (0 white, 1 black) and square, "ahead" is toward the color's promotion rank
+struct PawnMaskTable {
+    uint64_t adjacentFiles[8];
+    uint64_t front[2][64];      // ahead on the same file
+    uint64_t passed[2][64];     // ahead on the same and the adjacent files, no enemy pawn there means passed
+    uint64_t support[2][64];    // the adjacent files level with the square and behind it
+    uint64_t shield[2][64][2];  // the king's file and its neighbours, one and two ranks ahead
+
+    constexpr PawnMaskTable() : adjacentFiles(), front(), passed(), support(), shield() {
+        for (int file = 0; file < 8; file++) {
+            const uint64_t fileMask = 0x0101010101010101ULL << file;
+            adjacentFiles[file] = ((fileMask << 1) & NotAFile) | ((fileMask >> 1) & NotHFile);
+        }
+        for (int square = 0; square < 64; square++) {
+            const int file = square & 7;
+            const int rank = square >> 3;
+            const uint64_t fileMask = 0x0101010101010101ULL << file;
+            const uint64_t around = fileMask | adjacentFiles[file];
+            for (int color = 0; color < 2; color++) {
+                uint64_t ahead = 0;
+                uint64_t behind = 0;
+                for (int r = 0; r < 8; r++) {
+                    const uint64_t rankMask = 0xFFULL << (r * 8);
+                    if (color == 0 ? r > rank : r < rank)
+                        ahead |= rankMask;
+                    else
+                        behind |= rankMask;
+                }
+                front[color][square] = fileMask & ahead;
+                passed[color][square] = around & ahead;
+                support[color][square] = adjacentFiles[file] & behind;
+                for (int step = 1; step <= 2; step++) {
+                    const int shieldRank = color == 0 ? rank + step : rank - step;
+                    if (shieldRank >= 0 && shieldRank < 8)
+                        shield[color][square][step - 1] = around & (0xFFULL << (shieldRank * 8));
+                }
+            }
+        }
+    }
+};
+inline constexpr PawnMaskTable PawnMasks;
+
+// what the pawn structure is worth, worked out once per pawn formation
+struct PawnEntry {
+    uint64_t key;
+    uint64_t passed[2];     // passed pawns of white and black
+    int score;              // packed midgame/endgame doubled, isolated, backward and passed pawn terms, white positive
+};
+
+//
+// cache of pawn structure evaluations keyed by GameState::_pawnHash
+// pawns move rarely compared to the other pieces, so nearly every probe in a search is a hit
+// one table per search thread, so there is nothing to lock
+//
+class PawnHashTable {
+public:
+    static constexpr int ENTRIES = 1 << 14;
+
+    // the zeroed entries already hold the right answer for the pawnless key 0
+    PawnHashTable() : _entries(ENTRIES) { }
+
+    // the entry for the state's pawns, evaluated and stored first on a miss
+    const PawnEntry& probe(const GameState& state) {
+        PawnEntry& entry = _entries[state._pawnHash & (ENTRIES - 1)];
+        if (entry.key != state._pawnHash) {
+            evaluate(state, entry);
+        }
+        return entry;
+    }
+
+private:
+    static void evaluate(const GameState& state, PawnEntry& entry);
+
+    std::vector<PawnEntry> _entries;
+};
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstdint>
+#include "MagicBitboards.h"
+#include "SliderTables.h"       // generated into the build tree by attackgen
+#if defined(__GNUC__) || defined(_MSC_VER)
+#include <immintrin.h>
+#endif
+
+//
+// slider attack backends for the move generator
+//   magic        multiply and shift index into the generated MagicSliderAttacks table
+//   pext         BMI2 _pext_u64 index into the generated PextSliderAttacks table, no magic numbers needed
+//   kogge-stone  table free occluded fills, four directions at once in one AVX2 register
+// the generator uses whichever one the build picks with SLIDERS_MAGIC, SLIDERS_PEXT or SLIDERS_KOGGE_STONE,
+// left alone PEXT is used when compiling for a CPU with BMI2 that isn't a Zen 1/2 (where pext is microcoded)
+// the choice is made by the compiler flags, not at runtime: a build without -march=native or -mbmi2 uses magic
+// even on BMI2 hardware, a runtime switch would keep the lookups from being inlined into the generator
+// every backend is always compiled with its own target attribute, so the slider benchmark can compare them at runtime
+//
+#if !defined(SLIDERS_MAGIC) && !defined(SLIDERS_PEXT) && !defined(SLIDERS_KOGGE_STONE)
+    #if defined(__BMI2__) && !defined(__znver1__) && !defined(__znver2__)
+        #define SLIDERS_PEXT
+    #else
+        #define SLIDERS_MAGIC
+    #endif
+#endif
+
+#if defined(__GNUC__) && !defined(_MSC_VER)
+    #define SLIDERS_TARGET_BMI2 __attribute__((target("bmi2")))
+    #define SLIDERS_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+    #define SLIDERS_TARGET_BMI2
+    #define SLIDERS_TARGET_AVX2
+#endif
+
+// magic lookups, the entry for a square says where its attacks start in the shared table
+static inline uint64_t getRookAttacks(int square, uint64_t occupied) {
+    const MagicEntry& entry = Magics.rook[square];
+    return MagicSliderAttacks[entry.offset + (((occupied & entry.mask) * entry.magic) >> entry.shift)];
+}
+
+static inline uint64_t getBishopAttacks(int square, uint64_t occupied) {
+    const MagicEntry& entry = Magics.bishop[square];
+    return MagicSliderAttacks[entry.offset + (((occupied & entry.mask) * entry.magic) >> entry.shift)];
+}
+
+static inline uint64_t getQueenAttacks(int square, uint64_t occupied) {
+    return getRookAttacks(square, occupied) | getBishopAttacks(square, occupied);
+}
+
+SLIDERS_TARGET_BMI2 static inline uint64_t getRookAttacksPext(int square, uint64_t occupied) {
+    const MagicEntry& entry = Magics.rook[square];
+    return PextSliderAttacks[entry.offset + _pext_u64(occupied, entry.mask)];
+}
+
+SLIDERS_TARGET_BMI2 static inline uint64_t getBishopAttacksPext(int square, uint64_t occupied) {
+    const MagicEntry& entry = Magics.bishop[square];
+    return PextSliderAttacks[entry.offset + _pext_u64(occupied, entry.mask)];
+}
+
+//
+// kogge-stone occluded fill: spread the slider along the empty squares in three doubling steps,
+// then shift once more so the first blocker is included
+// the lanes hold north, east, south and west (or the four diagonals), left shifts in lanes 0-1, right in 2-3
+//
+SLIDERS_TARGET_AVX2 static inline uint64_t koggeStoneFill4(uint64_t slider, uint64_t occupied,
+                                                            const __m256i wrap, const __m256i step) {
+    // shift counts for the left lanes and the right lanes, the other half of each vector stays put
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i left1 = _mm256_blend_epi32(step, zero, 0xF0);
+    const __m256i right1 = _mm256_blend_epi32(step, zero, 0x0F);
+    const __m256i left2 = _mm256_add_epi64(left1, left1);
+    const __m256i right2 = _mm256_add_epi64(right1, right1);
+    const __m256i left4 = _mm256_add_epi64(left2, left2);
+    const __m256i right4 = _mm256_add_epi64(right2, right2);
+    #define KOGGE_SHIFT(value, left, right) _mm256_srlv_epi64(_mm256_sllv_epi64(value, left), right)
+
+    __m256i gen = _mm256_set1_epi64x((long long)slider);
+    __m256i pro = _mm256_and_si256(_mm256_set1_epi64x((long long)~occupied), wrap);
+    gen = _mm256_or_si256(gen, _mm256_and_si256(pro, KOGGE_SHIFT(gen, left1, right1)));
+    pro = _mm256_and_si256(pro, KOGGE_SHIFT(pro, left1, right1));
+    gen = _mm256_or_si256(gen, _mm256_and_si256(pro, KOGGE_SHIFT(gen, left2, right2)));
+    pro = _mm256_and_si256(pro, KOGGE_SHIFT(pro, left2, right2));
+    gen = _mm256_or_si256(gen, _mm256_and_si256(pro, KOGGE_SHIFT(gen, left4, right4)));
+    const __m256i attacks = _mm256_and_si256(KOGGE_SHIFT(gen, left1, right1), wrap);
+    #undef KOGGE_SHIFT
+
+    // fold the four lanes together
+    const __m128i half = _mm_or_si128(_mm256_castsi256_si128(attacks), _mm256_extracti128_si256(attacks, 1));
+    return (uint64_t)_mm_cvtsi128_si64(_mm_or_si128(half, _mm_unpackhi_epi64(half, half)));
+}
+
+SLIDERS_TARGET_AVX2 static inline uint64_t getRookAttacksKoggeStone(int square, uint64_t occupied) {
+    // north, east, south, west, the wrap masks keep east/west fills from crossing the board edge
+    const __m256i wrap = _mm256_setr_epi64x(-1LL, (long long)0xFEFEFEFEFEFEFEFEULL, -1LL, (long long)0x7F7F7F7F7F7F7F7FULL);
+    const __m256i step = _mm256_setr_epi64x(8, 1, 8, 1);
+    return koggeStoneFill4(1ULL << square, occupied, wrap, step);
+}
+
+SLIDERS_TARGET_AVX2 static inline uint64_t getBishopAttacksKoggeStone(int square, uint64_t occupied) {
+    // north east, north west, south west, south east
+    const __m256i wrap = _mm256_setr_epi64x((long long)0xFEFEFEFEFEFEFEFEULL, (long long)0x7F7F7F7F7F7F7F7FULL,
+                                            (long long)0x7F7F7F7F7F7F7F7FULL, (long long)0xFEFEFEFEFEFEFEFEULL);
+    const __m256i step = _mm256_setr_epi64x(9, 7, 9, 7);
+    return koggeStoneFill4(1ULL << square, occupied, wrap, step);
+}
+
+// the attack lookups the move generator calls, resolved at compile time
+static inline uint64_t rookAttacks(int square, uint64_t occupied) {
+#if defined(SLIDERS_PEXT)
+    return getRookAttacksPext(square, occupied);
+#elif defined(SLIDERS_KOGGE_STONE)
+    return getRookAttacksKoggeStone(square, occupied);
+#else
+    return getRookAttacks(square, occupied);
+#endif
+}
+
+static inline uint64_t bishopAttacks(int square, uint64_t occupied) {
+#if defined(SLIDERS_PEXT)
+    return getBishopAttacksPext(square, occupied);
+#elif defined(SLIDERS_KOGGE_STONE)
+    return getBishopAttacksKoggeStone(square, occupied);
+#else
+    return getBishopAttacks(square, occupied);
+#endif
+}
+
+static inline uint64_t queenAttacks(int square, uint64_t occupied) {
+    return rookAttacks(square, occupied) | bishopAttacks(square, occupied);
+}
+
+inline const char* sliderBackendName() {
+#if defined(SLIDERS_PEXT)
+    return "pext";
+#elif defined(SLIDERS_KOGGE_STONE)
+    return "kogge-stone";
+#else
+    return "magic";
+#endif
+}
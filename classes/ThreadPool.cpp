@@ -0,0 +1,56 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(int threads) : _generation(0), _running(0), _quit(false) {
+    for (int i = 0; i < threads; i++) {
+        _threads.emplace_back(&ThreadPool::threadLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    wait();
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _quit = true;
+    }
+    _wake.notify_all();
+    for (auto& thread : _threads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::run(std::function<void(int)> job) {
+    wait();
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _job = std::move(job);
+        _running = size();
+        _generation++;
+    }
+    _wake.notify_all();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _done.wait(lock, [this] { return _running == 0; });
+}
+
+void ThreadPool::threadLoop(int index) {
+    unsigned int seen = 0;
+    while (true) {
+        std::function<void(int)> job;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wake.wait(lock, [&] { return _quit || _generation != seen; });
+            if (_quit)
+                return;
+            seen = _generation;
+            job = _job;
+        }
+        job(index);
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _running--;
+        }
+        _done.notify_all();
+    }
+}
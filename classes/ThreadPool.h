@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+//
+// fixed set of threads created once and reused, so starting a search doesn't spawn threads
+// run() hands the same job to every thread with its index, wait() blocks until they all return
+//
+class ThreadPool {
+public:
+    explicit ThreadPool(int threads);
+    ~ThreadPool();
+
+    int size() const { return (int)_threads.size(); }
+
+    void run(std::function<void(int)> job);
+    void wait();
+
+private:
+    void threadLoop(int index);
+
+    std::vector<std::thread> _threads;
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::condition_variable _done;
+    std::function<void(int)> _job;
+    unsigned int _generation;
+    int _running;
+    bool _quit;
+};
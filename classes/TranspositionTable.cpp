@@ -0,0 +1,44 @@
+#include "TranspositionTable.h"
+
+TranspositionTable::~TranspositionTable() {
+    delete[] _buckets;
+}
+
+void TranspositionTable::resize(size_t megabytes) {
+    size_t count = (megabytes * 1024 * 1024) / sizeof(Bucket);
+    size_t buckets = 1;
+    while (buckets * 2 <= count) {
+        buckets *= 2;
+    }
+    if (buckets != _bucketCount) {
+        delete[] _buckets;
+        _buckets = new Bucket[buckets];
+        _bucketCount = buckets;
+    }
+    clear();
+}
+
+void TranspositionTable::clear() {
+    for (size_t i = 0; i < _bucketCount; i++) {
+        for (int j = 0; j < ENTRIES_PER_BUCKET; j++) {
+            _buckets[i].entries[j].check.store(0, std::memory_order_relaxed);
+            _buckets[i].entries[j].data.store(0, std::memory_order_relaxed);
+        }
+    }
+    _age = 0;
+}
+
+int TranspositionTable::hashfull() const {
+    if (!_buckets)
+        return 0;
+    size_t samples = _bucketCount < 250 ? _bucketCount : 250;
+    int used = 0;
+    for (size_t i = 0; i < samples; i++) {
+        for (int j = 0; j < ENTRIES_PER_BUCKET; j++) {
+            uint64_t packed = _buckets[i].entries[j].data.load(std::memory_order_relaxed);
+            if (packed != 0 && packedAge(packed) == _age)
+                used++;
+        }
+    }
+    return (int)((used * 1000) / (samples * ENTRIES_PER_BUCKET));
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include "GameState.h"
+
+enum TTBound {
+    TTNone = 0,
+    TTUpper = 1,   // fail low, score is at most this
+    TTLower = 2,   // fail high, score is at least this
+    TTExact = 3
+};
+
+// an unpacked table entry as handed back by probe()
+struct TTData {
+    BitMove move;
+    int score;
+    int depth;
+    TTBound bound;
+};
+
+//
+// shared transposition table
+// entries hold the key xor'd with their data, so threads can read and write without locks:
+// a torn write from another thread simply fails verification and reads as a miss
+//
+class TranspositionTable {
+public:
+    // four 16 byte entries fill one 64 byte cache line
+    static constexpr int ENTRIES_PER_BUCKET = 4;
+
+    TranspositionTable() : _buckets(nullptr), _bucketCount(0), _age(0) { }
+    ~TranspositionTable();
+
+    // size in megabytes, rounded down to a power of two number of buckets
+    void resize(size_t megabytes);
+    void clear();
+    // call once per search so older entries become cheaper to replace
+    void newSearch() { _age = (_age + 1) & AGE_MASK; }
+    // entries per thousand used by the current search, sampled from the first buckets
+    int hashfull() const;
+    size_t sizeInBytes() const { return _bucketCount * sizeof(Bucket); }
+
+    bool probe(uint64_t key, TTData& data) const {
+        if (!_buckets)
+            return false;
+        const Bucket& bucket = _buckets[key & (_bucketCount - 1)];
+        for (int i = 0; i < ENTRIES_PER_BUCKET; i++) {
+            const uint64_t packed = bucket.entries[i].data.load(std::memory_order_relaxed);
+            const uint64_t check = bucket.entries[i].check.load(std::memory_order_relaxed);
+            if ((check ^ packed) == key && packed != 0) {
+                unpack(packed, data);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // mate scores should be made relative to the node before storing, see ChessAI
+    void store(uint64_t key, const BitMove& move, int score, int depth, TTBound bound) {
+        if (!_buckets)
+            return;
+        Bucket& bucket = _buckets[key & (_bucketCount - 1)];
+
+        // reuse the slot holding this position, otherwise evict the shallowest and oldest entry
+        Entry* replace = &bucket.entries[0];
+        int worstValue = 1 << 30;
+        for (int i = 0; i < ENTRIES_PER_BUCKET; i++) {
+            Entry& entry = bucket.entries[i];
+            const uint64_t packed = entry.data.load(std::memory_order_relaxed);
+            const uint64_t check = entry.check.load(std::memory_order_relaxed);
+            if ((check ^ packed) == key) {
+                TTData existing;
+                unpack(packed, existing);
+                // keep a deeper result from this search unless the new one is exact
+                if (bound != TTExact && existing.depth > depth + 2 && packedAge(packed) == _age)
+                    return;
+                // don't lose the best move when storing a result without one
+                BitMove bestMove = (move == BitMove()) ? existing.move : move;
+                write(entry, key, pack(bestMove, score, depth, bound));
+                return;
+            }
+            const int ageDistance = (_age - packedAge(packed)) & AGE_MASK;
+            const int value = (packed == 0) ? -(1 << 20) : packedDepth(packed) - 8 * ageDistance;
+            if (value < worstValue) {
+                worstValue = value;
+                replace = &entry;
+            }
+        }
+        write(*replace, key, pack(move, score, depth, bound));
+    }
+
+private:
+    static constexpr int AGE_MASK = 0x3F;
+
+    struct Entry {
+        std::atomic<uint64_t> check;   // key ^ data
+        std::atomic<uint64_t> data;    // move:16 score:16 depth:8 bound:2 age:6
+    };
+    struct alignas(64) Bucket {
+        Entry entries[ENTRIES_PER_BUCKET];
+    };
+
+    static uint64_t pack(const BitMove& move, int score, int depth, TTBound bound) {
+        return (uint64_t)move.data
+             | ((uint64_t)(uint16_t)(int16_t)score << 16)
+             | ((uint64_t)(uint8_t)depth << 32)
+             | ((uint64_t)bound << 40);
+    }
+    void write(Entry& entry, uint64_t key, uint64_t packed) {
+        packed |= (uint64_t)_age << 42;
+        entry.data.store(packed, std::memory_order_relaxed);
+        entry.check.store(key ^ packed, std::memory_order_relaxed);
+    }
+    static void unpack(uint64_t packed, TTData& data) {
+        data.move.data = (uint16_t)packed;
+        data.score = (int16_t)(uint16_t)(packed >> 16);
+        data.depth = (uint8_t)(packed >> 32);
+        data.bound = (TTBound)((packed >> 40) & 3);
+    }
+    static int packedDepth(uint64_t packed) { return (uint8_t)(packed >> 32); }
+    static int packedAge(uint64_t packed) { return (int)(packed >> 42) & AGE_MASK; }
+
+    Bucket* _buckets;
+    size_t _bucketCount;
+    int _age;
+};
@@ -0,0 +1,54 @@
+//
+// writes the slider attack tables as a header at build time, so the engine never has to build them at startup
+// both tables hold the attacks for every square and blocker subset back to back, laid out by Magics in
+// MagicBitboards.h: the magic table is indexed by the magic multiply, the pext table by the packed blocker bits
+//
+// usage: attackgen <output header>
+//
+
+#include <cstdio>
+#include <vector>
+#include "classes/MagicBitboards.h"
+
+static void writeTable(FILE* file, const char* name, const std::vector<uint64_t>& table) {
+    std::fprintf(file, "alignas(64) inline constexpr uint64_t %s[%zu] = {\n", name, table.size());
+    for (size_t i = 0; i < table.size(); i++) {
+        std::fprintf(file, "%s0x%llxULL,%s", (i % 4) == 0 ? "    " : "", (unsigned long long)table[i], (i % 4) == 3 ? "\n" : " ");
+    }
+    std::fprintf(file, "};\n\n");
+}
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        std::fprintf(stderr, "usage: attackgen <output header>\n");
+        return 1;
+    }
+
+    std::vector<uint64_t> magicTable(SLIDER_TABLE_SIZE, 0);
+    std::vector<uint64_t> pextTable(SLIDER_TABLE_SIZE, 0);
+    for (int square = 0; square < 64; square++) {
+        for (int rook = 0; rook < 2; rook++) {
+            const MagicEntry& entry = rook ? Magics.rook[square] : Magics.bishop[square];
+            const int bits = countOnes(entry.mask);
+            for (int index = 0; index < (1 << bits); index++) {
+                // the index's bits deposited into the mask, so pext of the subset gives the index back
+                const uint64_t subset = indexToUint64(index, bits, entry.mask);
+                const uint64_t attacks = rook ? ratt(square, subset) : batt(square, subset);
+                magicTable[entry.offset + ((subset * entry.magic) >> entry.shift)] = attacks;
+                pextTable[entry.offset + index] = attacks;
+            }
+        }
+    }
+
+    FILE* file = std::fopen(argv[1], "w");
+    if (!file) {
+        std::fprintf(stderr, "attackgen: can't write %s\n", argv[1]);
+        return 1;
+    }
+    std::fprintf(file, "// generated by attackgen from MagicBitboards.h, do not edit\n");
+    std::fprintf(file, "#pragma once\n\n#include <stdint.h>\n\n");
+    writeTable(file, "MagicSliderAttacks", magicTable);
+    writeTable(file, "PextSliderAttacks", pextTable);
+    std::fclose(file);
+    return 0;
+}
@@ -0,0 +1,409 @@
+//
+// builds the win/draw/loss endgame tables that Bitbases probes, entirely offline
+// every table is solved by retrograde iteration: mates and stalemates first, then a position is a win
+// as soon as one move reaches a lost position and a loss once every move reaches a won one, repeated until
+// nothing changes, whatever is left over is a draw
+// after the first pass only the positions one move before something that just got decided are looked at again
+// the tables a capture or promotion leads into are built first and written to the same file
+// the fifty move rule is not taken into account, and tables with pawns on both sides are refused
+// because en passant isn't part of the index
+//
+// usage: bitbasegen [--threads N] <output file> [tables...]
+//   tables are named by material, stronger side first, e.g. KPK KRKP, the default set is listed below
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "classes/GameState.h"
+#include "classes/ThreadPool.h"
+#include "classes/SliderAttacks.h"
+
+static const char* _defaultTables[] = {
+    "KPK", "KNK", "KBK", "KRK", "KQK",
+    "KBNK", "KQKR", "KQKP", "KRKP", "KRKB", "KRKN",
+};
+
+// only used while building, never written to the file
+constexpr uint8_t BitbaseUnknown = 4;
+// indices handed out to a thread at a time
+constexpr size_t BLOCK_SIZE = 4096;
+
+static const char* _pieceLetters = "PNBRQ";
+
+// strongest first, the order Bitbases::describe lists the pieces in
+static std::string sortPieces(std::string pieces) {
+    std::sort(pieces.begin(), pieces.end(), [](char a, char b) {
+        return std::strchr(_pieceLetters, a) > std::strchr(_pieceLetters, b);
+    });
+    return pieces;
+}
+
+// the table name for one side's pieces against the other's, the same choice of colors describe makes
+static std::string canonicalName(std::string white, std::string black) {
+    white = sortPieces(white);
+    black = sortPieces(black);
+    bool swap = black.size() > white.size();
+    if (black.size() == white.size()) {
+        for (size_t i = 0; i < white.size(); i++) {
+            if (white[i] != black[i]) {
+                swap = std::strchr(_pieceLetters, black[i]) > std::strchr(_pieceLetters, white[i]);
+                break;
+            }
+        }
+    }
+    return swap ? "K" + black + "K" + white : "K" + white + "K" + black;
+}
+
+// splits "KRKP" into "R" and "P", false if it isn't a table this program can build
+static bool splitName(const std::string& name, std::string& white, std::string& black) {
+    const size_t second = name.find('K', 1);
+    if (name.size() > BITBASE_MAX_PIECES || name.empty() || name[0] != 'K' || second == std::string::npos)
+        return false;
+    white = name.substr(1, second - 1);
+    black = name.substr(second + 1);
+    for (char piece : white + black) {
+        if (!std::strchr(_pieceLetters, piece))
+            return false;
+    }
+    return white.find('P') == std::string::npos || black.find('P') == std::string::npos;
+}
+
+// every table a capture or a promotion in this one leads into, except the bare kings
+static std::vector<std::string> dependencies(const std::string& name) {
+    std::string white;
+    std::string black;
+    splitName(name, white, black);
+    std::vector<std::string> result;
+    auto add = [&](const std::string& w, const std::string& b) {
+        if (!w.empty() || !b.empty())
+            result.push_back(canonicalName(w, b));
+    };
+    for (int side = 0; side < 2; side++) {
+        const std::string& own = side ? black : white;
+        const std::string& other = side ? white : black;
+        for (size_t i = 0; i < own.size(); i++) {
+            std::string rest = own;
+            rest.erase(i, 1);
+            add(side ? other : rest, side ? rest : other);
+            if (own[i] == 'P') {
+                for (char promoted : std::string("NBRQ")) {
+                    const std::string promotion = rest + promoted;
+                    add(side ? other : promotion, side ? promotion : other);
+                }
+            }
+        }
+    }
+    return result;
+}
+
+// the inverse of Bitbases::index, without checking whether the index is the one describe would give
+static void decode(uint64_t key, size_t index, BitbasePosition& position) {
+    const std::string name = Bitbases::keyName(key);
+    const size_t second = name.find('K', 1);
+    position.key = key;
+    position.count = (int)name.size();
+    position.piece[0] = WHITE_KING;
+    position.piece[1] = BLACK_KING;
+    int count = 2;
+    for (size_t i = 1; i < name.size(); i++) {
+        if (i == second)
+            continue;
+        const int piece = (int)(std::strchr(_pieceLetters, name[i]) - _pieceLetters);
+        position.piece[count++] = piece + (i < second ? WHITE_PAWNS : BLACK_PAWNS);
+    }
+    for (int i = position.count - 1; i >= 1; i--) {
+        position.square[i] = (int)(index % 64);
+        index /= 64;
+    }
+    if (Bitbases::hasPawns(key)) {
+        position.square[0] = (int)(index % 32 / 4 * 8 + index % 4);
+        index /= 32;
+    } else {
+        static const int triangle[10] = { 0, 1, 2, 3, 9, 10, 11, 18, 19, 27 };
+        position.square[0] = triangle[index % 10];
+        index /= 10;
+    }
+    position.sideToMove = (int)index;
+}
+
+class Generator {
+public:
+    explicit Generator(int threads) : _pool(threads) {
+        for (int i = 0; i < threads; i++) {
+            _states.push_back(std::make_unique<GameState>());
+        }
+    }
+
+    void build(const std::string& name);
+    bool write(const char* path) const;
+
+private:
+    // result for the side to move in a position one move into the table being built
+    uint8_t childResult(const GameState& state) const;
+    // works out one position if it can be, true when it got decided
+    bool solve(GameState& state, size_t index, int pass);
+    // queues every position a quiet move away from this one for the next pass, the only ones it can change
+    void markPredecessors(const BitbasePosition& position, int pass);
+
+    ThreadPool _pool;
+    std::vector<std::unique_ptr<GameState>> _states;
+    std::map<uint64_t, std::vector<uint8_t>> _tables;
+    // the table being built, shared by every thread
+    uint64_t _key = 0;
+    std::unique_ptr<std::atomic<uint8_t>[]> _current;
+    // the pass each position gets looked at again in
+    std::unique_ptr<std::atomic<uint16_t>[]> _revisit;
+};
+
+uint8_t Generator::childResult(const GameState& state) const {
+    BitbasePosition position;
+    Bitbases::describe(state, position);
+    if (position.count == 2)
+        return BitbaseDraw;
+    const size_t index = Bitbases::index(position);
+    if (position.key == _key)
+        return _current[index].load(std::memory_order_relaxed);
+    return _tables.at(position.key)[index];
+}
+
+void Generator::markPredecessors(const BitbasePosition& position, int pass) {
+    uint64_t occupied = 0;
+    for (int i = 0; i < position.count; i++) {
+        occupied |= 1ULL << position.square[i];
+    }
+    // the side that made the last move, captures and promotions only lead out of the table
+    const int mover = 1 - position.sideToMove;
+    for (int i = 0; i < position.count; i++) {
+        const int piece = position.piece[i];
+        if ((piece < BLACK_PAWNS ? 0 : 1) != mover)
+            continue;
+        const int to = position.square[i];
+        uint64_t sources = 0;
+        switch (piece % BLACK_PAWNS) {
+        case WHITE_PAWNS: {
+            const int back = mover == 0 ? -8 : 8;
+            const int single = to + back;
+            if (single >= 8 && single < 56 && !(occupied & (1ULL << single))) {
+                sources |= 1ULL << single;
+                if ((to >> 3) == (mover == 0 ? 3 : 4))
+                    sources |= 1ULL << (single + back);
+            }
+            break;
+        }
+        case WHITE_KNIGHTS: sources = KnightAttacks[to]; break;
+        case WHITE_BISHOPS: sources = bishopAttacks(to, occupied); break;
+        case WHITE_ROOKS: sources = rookAttacks(to, occupied); break;
+        case WHITE_QUEENS: sources = queenAttacks(to, occupied); break;
+        default: sources = KingAttacks[to]; break;
+        }
+        BitBoard(sources & ~occupied).forEachBit([&](int from) {
+            BitbasePosition previous = position;
+            previous.square[i] = from;
+            previous.sideToMove = mover;
+            _revisit[Bitbases::index(previous)].store((uint16_t)(pass + 1), std::memory_order_relaxed);
+        });
+    }
+}
+
+bool Generator::solve(GameState& state, size_t index, int pass) {
+    if (_current[index].load(std::memory_order_relaxed) != BitbaseUnknown)
+        return false;
+    if (pass > 0 && _revisit[index].load(std::memory_order_relaxed) != pass)
+        return false;
+    const bool firstPass = (pass == 0);
+
+    BitbasePosition position;
+    decode(_key, index, position);
+    char board[64];
+    std::memset(board, '0', sizeof(board));
+    uint64_t used = 0;
+    for (int i = 0; i < position.count; i++) {
+        const int piece = position.piece[i];
+        board[position.square[i]] = (piece < BLACK_PAWNS) ? "PNBRQK"[piece] : "pnbrqk"[piece - BLACK_PAWNS];
+        used |= 1ULL << position.square[i];
+    }
+    state.init(board, position.sideToMove == 0 ? WHITE : BLACK);
+
+    if (firstPass) {
+        // two pieces on a square, pawns on the back ranks, an index describe would never give
+        // or the side that just moved left its king in check
+        bool valid = BitBoard(used).countBits() == position.count &&
+                     !((state._bitboards[WHITE_PAWNS] | state._bitboards[BLACK_PAWNS]).getData() & PromotionRanks);
+        if (valid) {
+            BitbasePosition check;
+            valid = Bitbases::describe(state, check) && check.key == _key && Bitbases::index(check) == index;
+        }
+        if (valid) {
+            state.color = -state.color;
+            valid = !state.inCheck();
+            state.color = -state.color;
+        }
+        if (!valid) {
+            _current[index].store(BitbaseInvalid, std::memory_order_relaxed);
+            return false;
+        }
+    }
+
+    MoveList moves;
+    state.generateAllMoves(moves);
+    uint8_t result = BitbaseUnknown;
+    if (moves.empty()) {
+        result = state.inCheck() ? BitbaseLoss : BitbaseDraw;
+    } else {
+        bool allWon = true;
+        for (const BitMove& move : moves) {
+            state.pushMove(move);
+            const uint8_t child = childResult(state);
+            state.popMove();
+            if (child == BitbaseLoss) {
+                result = BitbaseWin;
+                break;
+            }
+            allWon = allWon && child == BitbaseWin;
+        }
+        if (result == BitbaseUnknown && allWon)
+            result = BitbaseLoss;
+    }
+    if (result == BitbaseUnknown)
+        return false;
+    _current[index].store(result, std::memory_order_relaxed);
+    markPredecessors(position, pass);
+    return true;
+}
+
+void Generator::build(const std::string& name) {
+    const uint64_t key = Bitbases::makeKey(name);
+    if (_tables.count(key))
+        return;
+    for (const std::string& dependency : dependencies(name)) {
+        build(dependency);
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    const size_t size = Bitbases::tableSize(key);
+    _key = key;
+    _current.reset(new std::atomic<uint8_t>[size]);
+    _revisit.reset(new std::atomic<uint16_t>[size]);
+    for (size_t i = 0; i < size; i++) {
+        _current[i].store(BitbaseUnknown, std::memory_order_relaxed);
+        _revisit[i].store(0, std::memory_order_relaxed);
+    }
+
+    int passes = 0;
+    for (bool changed = true; changed; passes++) {
+        std::atomic<size_t> nextBlock(0);
+        std::atomic<bool> anyChange(false);
+        const int pass = passes;
+        _pool.run([&](int thread) {
+            GameState& state = *_states[thread];
+            bool decided = false;
+            for (size_t block = nextBlock.fetch_add(BLOCK_SIZE); block < size; block = nextBlock.fetch_add(BLOCK_SIZE)) {
+                const size_t end = std::min(block + BLOCK_SIZE, size);
+                for (size_t index = block; index < end; index++) {
+                    decided |= solve(state, index, pass);
+                }
+            }
+            if (decided)
+                anyChange = true;
+        });
+        _pool.wait();
+        changed = anyChange.load();
+    }
+
+    std::vector<uint8_t> table(size);
+    size_t counts[4] = { 0, 0, 0, 0 };
+    for (size_t i = 0; i < size; i++) {
+        const uint8_t result = _current[i].load(std::memory_order_relaxed);
+        table[i] = (result == BitbaseUnknown) ? (uint8_t)BitbaseDraw : result;
+        counts[table[i]]++;
+    }
+    _current.reset();
+    _revisit.reset();
+    _tables[key] = std::move(table);
+
+    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%-6s %10zu positions  %10zu wins %10zu draws %10zu losses  %3d passes %8lld ms\n",
+                name.c_str(), size - counts[BitbaseInvalid], counts[BitbaseWin], counts[BitbaseDraw], counts[BitbaseLoss],
+                passes, (long long)ms);
+}
+
+bool Generator::write(const char* path) const {
+    FILE* file = std::fopen(path, "wb");
+    if (!file)
+        return false;
+    // header, then the directory, then each table starting on a 64 byte boundary
+    unsigned char header[64] = { 0 };
+    std::memcpy(header, "CHESSBB1", 8);
+    const uint32_t count = (uint32_t)_tables.size();
+    std::memcpy(header + 8, &count, sizeof(count));
+    std::fwrite(header, 1, sizeof(header), file);
+
+    uint64_t offset = (sizeof(header) + count * 16 + 63) & ~63ULL;
+    std::vector<std::vector<uint8_t>> packed;
+    for (const auto& [key, table] : _tables) {
+        std::vector<uint8_t> bytes((table.size() + 3) / 4, 0);
+        for (size_t i = 0; i < table.size(); i++) {
+            bytes[i >> 2] |= table[i] << ((i & 3) * 2);
+        }
+        const uint64_t entry[2] = { key, offset };
+        std::fwrite(entry, sizeof(uint64_t), 2, file);
+        offset = (offset + bytes.size() + 63) & ~63ULL;
+        packed.push_back(std::move(bytes));
+    }
+    const unsigned char padding[64] = { 0 };
+    long position = (long)(sizeof(header) + count * 16);
+    for (const std::vector<uint8_t>& bytes : packed) {
+        std::fwrite(padding, 1, (64 - position % 64) % 64, file);
+        position += (64 - position % 64) % 64;
+        std::fwrite(bytes.data(), 1, bytes.size(), file);
+        position += (long)bytes.size();
+    }
+    return std::fclose(file) == 0;
+}
+
+int main(int argc, char** argv) {
+    int threads = std::max(1, (int)std::thread::hardware_concurrency());
+    const char* output = nullptr;
+    std::vector<std::string> names;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = std::max(1, std::atoi(argv[++i]));
+        } else if (!output) {
+            output = argv[i];
+        } else {
+            names.push_back(argv[i]);
+        }
+    }
+    if (!output) {
+        std::fprintf(stderr, "usage: bitbasegen [--threads N] <output file> [tables...]\n");
+        return 1;
+    }
+    if (names.empty()) {
+        names.assign(std::begin(_defaultTables), std::end(_defaultTables));
+    }
+
+    Generator generator(threads);
+    for (const std::string& name : names) {
+        std::string white;
+        std::string black;
+        if (!splitName(name, white, black) || (white.empty() && black.empty())) {
+            std::fprintf(stderr, "bitbasegen: can't build %s, up to %d pieces and pawns on one side only\n", name.c_str(), BITBASE_MAX_PIECES);
+            return 1;
+        }
+        generator.build(canonicalName(white, black));
+    }
+    if (!generator.write(output)) {
+        std::fprintf(stderr, "bitbasegen: can't write %s\n", output);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,289 @@
+//
+// compiles PGN files into an opening book that OpeningBook reads, keyed with BookKeys
+// every move of the first plies of every finished game is counted, weighted 2 for a win, 1 for a draw
+// and 0 for a loss of the side that played it, games without a result are skipped
+// a game stops counting at the first move that can't be read, the rest of the file is still used
+//
+// usage: bookgen [options] <output book> <pgn files...>
+//   --plies N         only the first N plies of each game go in (default 20)
+//   --min-games N     leave out moves played in fewer than N games (default 1)
+//
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "classes/OpeningBook.h"
+
+static const char* START_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+struct MoveStats {
+    uint32_t games = 0;
+    uint32_t score = 0;     // half points, 2 per win and 1 per draw
+};
+
+// one move as it was played, scored once the game's result is known
+struct PlayedMove {
+    uint64_t key;
+    uint16_t move;
+    int side;               // 0 white, 1 black
+};
+
+static std::map<std::pair<uint64_t, uint16_t>, MoveStats> _book;
+
+// the legal move a SAN string like Nbd7, exd5, e8=Q+ or O-O stands for, an empty move if there isn't one
+static BitMove parseSan(GameState& state, std::string san) {
+    while (!san.empty() && std::strchr("+#!?", san.back())) {
+        san.pop_back();
+    }
+    MoveList moves;
+    state.generateAllMoves(moves);
+    if (san == "O-O" || san == "0-0" || san == "O-O-O" || san == "0-0-0") {
+        const int type = san.size() == 3 ? KingCastle : QueenCastle;
+        for (const BitMove& move : moves) {
+            if (move.type() == type)
+                return move;
+        }
+        return BitMove();
+    }
+
+    int promotion = -1;
+    if (san.size() > 2 && std::strchr("NBRQ", san.back())) {
+        promotion = (int)(std::strchr("NBRQ", san.back()) - "NBRQ");
+        san.pop_back();
+        if (san.back() == '=')
+            san.pop_back();
+    }
+    char piece = 'P';
+    if (!san.empty() && std::strchr("NBRQK", san[0])) {
+        piece = san[0];
+        san.erase(0, 1);
+    }
+    san.erase(std::remove(san.begin(), san.end(), 'x'), san.end());
+    if (san.size() < 2 || san[san.size() - 2] < 'a' || san[san.size() - 2] > 'h' || san.back() < '1' || san.back() > '8')
+        return BitMove();
+    const int to = (san.back() - '1') * 8 + (san[san.size() - 2] - 'a');
+    // whatever is left is the file and or rank the piece comes from
+    int fromFile = -1;
+    int fromRank = -1;
+    for (size_t i = 0; i + 2 < san.size(); i++) {
+        if (san[i] >= 'a' && san[i] <= 'h')
+            fromFile = san[i] - 'a';
+        else if (san[i] >= '1' && san[i] <= '8')
+            fromRank = san[i] - '1';
+    }
+
+    for (const BitMove& move : moves) {
+        if (move.to() != to || move.isCastle() || std::toupper((unsigned char)state.state[move.from()]) != piece)
+            continue;
+        if ((fromFile >= 0 && (move.from() & 7) != fromFile) || (fromRank >= 0 && (move.from() >> 3) != fromRank))
+            continue;
+        // a promotion without a piece is taken to be a queen
+        if (move.isPromotion() && (move.type() & 3) != (promotion >= 0 ? promotion : 3))
+            continue;
+        return move;
+    }
+    return BitMove();
+}
+
+static bool isResult(const std::string& token) {
+    return token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*";
+}
+
+static void scoreGame(const std::vector<PlayedMove>& played, const std::string& result) {
+    if (result == "*")
+        return;
+    for (const PlayedMove& move : played) {
+        MoveStats& stats = _book[{ move.key, move.move }];
+        stats.games++;
+        if (result == "1/2-1/2")
+            stats.score += 1;
+        else if ((result == "1-0") == (move.side == 0))
+            stats.score += 2;
+    }
+}
+
+// adds every game in the file to _book, returns how many games were read
+static int readPgn(const std::string& path, int maxPlies) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return -1;
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    const std::string text = buffer.str();
+
+    GameState state;
+    std::string fen = START_FEN;
+    std::vector<PlayedMove> played;
+    bool started = false;
+    bool broken = false;
+    int games = 0;
+    auto startGame = [&]() {
+        state.initFEN(fen);
+        played.clear();
+        started = true;
+        broken = false;
+    };
+
+    size_t i = 0;
+    while (i < text.size()) {
+        const char c = text[i];
+        if (std::isspace((unsigned char)c)) {
+            i++;
+        } else if (c == '[') {
+            // tag pair, only the starting position matters here
+            const size_t end = text.find(']', i);
+            const std::string tag = text.substr(i + 1, (end == std::string::npos ? text.size() : end) - i - 1);
+            const size_t quote = tag.find('"');
+            if (tag.compare(0, 4, "FEN ") == 0 && quote != std::string::npos) {
+                fen = tag.substr(quote + 1, tag.rfind('"') - quote - 1);
+            }
+            i = (end == std::string::npos) ? text.size() : end + 1;
+        } else if (c == '{') {
+            const size_t end = text.find('}', i);
+            i = (end == std::string::npos) ? text.size() : end + 1;
+        } else if (c == ';' || (c == '%' && (i == 0 || text[i - 1] == '\n'))) {
+            const size_t end = text.find('\n', i);
+            i = (end == std::string::npos) ? text.size() : end + 1;
+        } else if (c == '(') {
+            // variations aren't part of the game
+            int depth = 0;
+            for (; i < text.size(); i++) {
+                if (text[i] == '(')
+                    depth++;
+                else if (text[i] == ')' && --depth == 0)
+                    break;
+            }
+            i++;
+        } else {
+            size_t end = i;
+            while (end < text.size() && !std::isspace((unsigned char)text[end]) && !std::strchr("[]{}();", text[end])) {
+                end++;
+            }
+            std::string token = text.substr(i, end - i);
+            i = end;
+            if (isResult(token)) {
+                if (started) {
+                    scoreGame(played, token);
+                    games++;
+                }
+                started = false;
+                fen = START_FEN;
+                continue;
+            }
+            // move numbers, "12." or "12...", may be glued to the move
+            size_t skip = 0;
+            while (skip < token.size() && (std::isdigit((unsigned char)token[skip]) || token[skip] == '.')) {
+                skip++;
+            }
+            if (skip == token.size() || token[0] == '$')
+                continue;
+            token.erase(0, skip);
+            if (!started)
+                startGame();
+            if (broken || state._undo.size() >= maxPlies)
+                continue;
+            const BitMove move = parseSan(state, token);
+            if (move == BitMove()) {
+                std::fprintf(stderr, "bookgen: %s: can't read move '%s', skipping the rest of the game\n", path.c_str(), token.c_str());
+                broken = true;
+                continue;
+            }
+            played.push_back({ OpeningBook::key(state), OpeningBook::encodeMove(move), state.color == WHITE ? 0 : 1 });
+            state.pushMove(move);
+        }
+    }
+    return games;
+}
+
+static void writeBig(FILE* file, uint64_t value, int bytes) {
+    unsigned char data[8];
+    for (int i = 0; i < bytes; i++) {
+        data[i] = (unsigned char)(value >> (8 * (bytes - 1 - i)));
+    }
+    std::fwrite(data, 1, bytes, file);
+}
+
+// entries sorted by key and then by weight, each position's weights scaled down to fit in 16 bits
+static bool writeBook(const char* path, int minGames) {
+    struct Entry {
+        uint64_t key;
+        uint16_t move;
+        uint32_t weight;
+    };
+    std::vector<Entry> entries;
+    for (const auto& [position, stats] : _book) {
+        if ((int)stats.games >= minGames)
+            entries.push_back({ position.first, position.second, stats.score });
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        return a.key != b.key ? a.key < b.key : a.weight > b.weight;
+    });
+
+    FILE* file = std::fopen(path, "wb");
+    if (!file)
+        return false;
+    for (size_t first = 0; first < entries.size();) {
+        size_t last = first;
+        while (last < entries.size() && entries[last].key == entries[first].key) {
+            last++;
+        }
+        // sorted by weight, so the first one is the largest
+        const uint32_t largest = entries[first].weight;
+        for (size_t i = first; i < last; i++) {
+            uint32_t weight = entries[i].weight;
+            if (largest > 0xFFFF)
+                weight = std::max<uint32_t>(weight ? 1 : 0, (uint32_t)((uint64_t)weight * 0xFFFF / largest));
+            writeBig(file, entries[i].key, 8);
+            writeBig(file, entries[i].move, 2);
+            writeBig(file, weight, 2);
+            writeBig(file, 0, 4);
+        }
+        first = last;
+    }
+    std::printf("%zu book entries\n", entries.size());
+    return std::fclose(file) == 0;
+}
+
+int main(int argc, char** argv) {
+    int maxPlies = 20;
+    int minGames = 1;
+    const char* output = nullptr;
+    std::vector<std::string> inputs;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--plies") == 0 && i + 1 < argc) {
+            maxPlies = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--min-games") == 0 && i + 1 < argc) {
+            minGames = std::max(1, std::atoi(argv[++i]));
+        } else if (!output) {
+            output = argv[i];
+        } else {
+            inputs.push_back(argv[i]);
+        }
+    }
+    if (!output || inputs.empty()) {
+        std::fprintf(stderr, "usage: bookgen [--plies N] [--min-games N] <output book> <pgn files...>\n");
+        return 1;
+    }
+
+    for (const std::string& input : inputs) {
+        const int games = readPgn(input, maxPlies);
+        if (games < 0) {
+            std::fprintf(stderr, "bookgen: can't read %s\n", input.c_str());
+            return 1;
+        }
+        std::printf("%s: %d games\n", input.c_str(), games);
+    }
+    if (!writeBook(output, minGames)) {
+        std::fprintf(stderr, "bookgen: can't write %s\n", output);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,294 @@
+//
+// perft harness for GameState::generateAllMoves
+// builds without GLFW/ImGui so move generation can be measured and checked on its own
+//
+// usage: perft [options]
+//   --fen "<fen>"     run a single position instead of the standard suite
+//   --depth N         maximum depth (default depends on the position)
+//   --divide          print the node count below each root move
+//   --threads N       split the root moves across N worker threads
+//   --hash MB         enable the perft hash cache with the given size
+//   --no-bulk         disable bulk counting at the leaves
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <new>
+#include <vector>
+#include "classes/GameState.h"
+
+//
+// count every heap allocation made by this executable, so the harness can show that
+// move generation and make/unmake never allocate
+//
+static std::atomic<uint64_t> _heapAllocations(0);
+
+void* operator new(size_t size) {
+    _heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+// gcc flags free() inside a replaced operator delete as a mismatched pair
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+void operator delete(void* ptr, size_t) noexcept {
+    operator delete(ptr);
+}
+
+struct PerftPosition {
+    const char* name;
+    const char* fen;
+    int defaultDepth;
+    uint64_t expected[7]; // expected node counts for depth 1..7, 0 if unknown
+};
+
+static const PerftPosition _positions[] = {
+    { "startpos", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 5,
+      { 20, 400, 8902, 197281, 4865609, 119060324, 3195901860ULL } },
+    { "kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 4,
+      { 48, 2039, 97862, 4085603, 193690690, 8031647685ULL, 0 } },
+    { "position3", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 5,
+      { 14, 191, 2812, 43238, 674624, 11030083, 178633661 } },
+    { "position4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 4,
+      { 6, 264, 9467, 422333, 15833292, 706045033, 0 } },
+    { "position5", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 4,
+      { 44, 1486, 62379, 2103487, 89941194, 0, 0 } },
+    { "position6", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 4,
+      { 46, 2079, 89890, 3894594, 164075551, 6923051137ULL, 0 } },
+};
+
+//
+// perft hash cache
+// each entry stores the key xor'd with the packed depth/count so that a torn write
+// from another thread fails verification instead of returning a wrong count
+//
+struct PerftHashEntry {
+    std::atomic<uint64_t> check;
+    std::atomic<uint64_t> data;   // count << 8 | depth
+};
+
+class PerftHash {
+public:
+    PerftHash(size_t megabytes) {
+        size_t count = (megabytes * 1024 * 1024) / sizeof(PerftHashEntry);
+        _size = 1;
+        while (_size * 2 <= count) {
+            _size *= 2;
+        }
+        _entries = new PerftHashEntry[_size];
+        for (size_t i = 0; i < _size; i++) {
+            _entries[i].check.store(0, std::memory_order_relaxed);
+            _entries[i].data.store(0, std::memory_order_relaxed);
+        }
+    }
+    ~PerftHash() { delete[] _entries; }
+
+    bool probe(uint64_t key, int depth, uint64_t& count) const {
+        const PerftHashEntry& entry = _entries[key & (_size - 1)];
+        uint64_t data = entry.data.load(std::memory_order_relaxed);
+        uint64_t check = entry.check.load(std::memory_order_relaxed);
+        if ((check ^ data) != key || (int)(data & 0xFF) != depth)
+            return false;
+        count = data >> 8;
+        return true;
+    }
+
+    void store(uint64_t key, int depth, uint64_t count) {
+        PerftHashEntry& entry = _entries[key & (_size - 1)];
+        uint64_t data = (count << 8) | (uint64_t)depth;
+        entry.check.store(key ^ data, std::memory_order_relaxed);
+        entry.data.store(data, std::memory_order_relaxed);
+    }
+
+private:
+    PerftHashEntry* _entries;
+    size_t _size;
+};
+
+struct PerftOptions {
+    bool bulk = true;
+    bool divide = false;
+    int threads = 1;
+    PerftHash* hash = nullptr;
+};
+
+static std::string squareName(int square) {
+    std::string name;
+    name += (char)('a' + square % 8);
+    name += (char)('1' + square / 8);
+    return name;
+}
+
+static std::string moveName(const BitMove& move) {
+    std::string name = squareName(move.from()) + squareName(move.to());
+    if (move.isPromotion()) {
+        name += "nbrq"[move.type() & 3];
+    }
+    return name;
+}
+
+static uint64_t perft(GameState& state, int depth, const PerftOptions& options) {
+    if (depth == 0)
+        return 1;
+
+    uint64_t key = 0;
+    uint64_t nodes = 0;
+    if (options.hash && depth > 1) {
+        key = state._zobristHash;
+        if (options.hash->probe(key, depth, nodes))
+            return nodes;
+    }
+
+    MoveList moves;
+    state.generateAllMoves(moves);
+    if (options.bulk && depth == 1)
+        return moves.size();
+
+    for (const auto& move : moves) {
+        state.pushMove(move);
+        nodes += perft(state, depth - 1, options);
+        state.popMove();
+    }
+
+    if (options.hash && depth > 1) {
+        options.hash->store(key, depth, nodes);
+    }
+    return nodes;
+}
+
+// runs the root moves on a pool of worker threads, each with its own copy of the state
+static uint64_t perftRoot(GameState& state, int depth, const PerftOptions& options) {
+    MoveList moves;
+    state.generateAllMoves(moves);
+    uint64_t counts[MAX_MOVES] = {};
+    if (depth <= 1) {
+        for (int i = 0; i < moves.size(); i++) {
+            counts[i] = 1;
+        }
+    } else {
+        std::atomic<int> nextMove(0);
+        auto worker = [&]() {
+            GameState local = state;
+            int index;
+            while ((index = nextMove.fetch_add(1)) < moves.size()) {
+                local.pushMove(moves[index]);
+                counts[index] = perft(local, depth - 1, options);
+                local.popMove();
+            }
+        };
+
+        // a single thread runs on the caller so the allocation counter stays at zero
+        int threadCount = std::max(1, options.threads);
+        if (threadCount == 1) {
+            worker();
+        } else {
+            std::vector<std::thread> pool;
+            for (int i = 1; i < threadCount; i++) {
+                pool.emplace_back(worker);
+            }
+            worker();
+            for (auto& thread : pool) {
+                thread.join();
+            }
+        }
+    }
+
+    uint64_t total = 0;
+    for (int i = 0; i < moves.size(); i++) {
+        if (options.divide) {
+            std::printf("  %s: %llu\n", moveName(moves[i]).c_str(), (unsigned long long)counts[i]);
+        }
+        total += counts[i];
+    }
+    return total;
+}
+
+// returns false if any depth did not match the expected count
+static bool runPosition(const char* name, const char* fen, int maxDepth, const uint64_t* expected, const PerftOptions& options) {
+    GameState state;
+    state.initFEN(fen);
+    std::printf("%s: %s\n", name, fen);
+
+    bool passed = true;
+    for (int depth = 1; depth <= maxDepth; depth++) {
+        uint64_t allocationsBefore = _heapAllocations.load();
+        auto start = std::chrono::steady_clock::now();
+        uint64_t nodes = perftRoot(state, depth, options);
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+        uint64_t allocations = _heapAllocations.load() - allocationsBefore;
+        uint64_t nps = elapsed > 0 ? (nodes * 1000000ULL) / elapsed : nodes;
+
+        const char* result = "";
+        if (expected && depth <= 7 && expected[depth - 1]) {
+            result = (nodes == expected[depth - 1]) ? "ok" : "MISMATCH";
+            if (nodes != expected[depth - 1])
+                passed = false;
+        }
+        std::printf("  depth %d nodes %12llu time %8.3fs nps %12llu allocs %llu %s",
+                    depth, (unsigned long long)nodes, elapsed / 1000000.0, (unsigned long long)nps,
+                    (unsigned long long)allocations, result);
+        if (expected && depth <= 7 && expected[depth - 1] && nodes != expected[depth - 1]) {
+            std::printf(" (expected %llu)", (unsigned long long)expected[depth - 1]);
+        }
+        std::printf("\n");
+    }
+    return passed;
+}
+
+int main(int argc, char** argv) {
+    PerftOptions options;
+    const char* fen = nullptr;
+    int depth = 0;
+    size_t hashMegabytes = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--fen") == 0 && i + 1 < argc) {
+            fen = argv[++i];
+        } else if (std::strcmp(argv[i], "--depth") == 0 && i + 1 < argc) {
+            depth = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--divide") == 0) {
+            options.divide = true;
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            options.threads = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--hash") == 0 && i + 1 < argc) {
+            hashMegabytes = (size_t)std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--no-bulk") == 0) {
+            options.bulk = false;
+        } else {
+            std::fprintf(stderr, "usage: perft [--fen \"<fen>\"] [--depth N] [--divide] [--threads N] [--hash MB] [--no-bulk]\n");
+            return 1;
+        }
+    }
+
+    PerftHash* hash = hashMegabytes ? new PerftHash(hashMegabytes) : nullptr;
+    options.hash = hash;
+
+    bool passed = true;
+    if (fen) {
+        passed = runPosition("custom", fen, depth > 0 ? depth : 4, nullptr, options);
+    } else {
+        for (const auto& position : _positions) {
+            passed &= runPosition(position.name, position.fen, depth > 0 ? depth : position.defaultDepth, position.expected, options);
+        }
+    }
+
+    delete hash;
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,178 @@
+//
+// microbenchmark for the slider attack backends in SliderAttacks.h
+// every backend runs over the same stream of squares and occupancies, after first being checked
+// against the slow ray walk, so the timings compare lookups and nothing else
+//
+// usage: sliderbench [options]
+//   --lookups N       occupancies in the stream (default 65536)
+//   --rounds N        passes over the stream per backend (default 200)
+//   --density D       rough fraction of occupied squares, 1 = 50%, 2 = 25%, 3 = 12.5% (default 2)
+//
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "classes/SliderAttacks.h"
+
+struct Lookup {
+    int square;
+    uint64_t occupancy;
+};
+
+static uint64_t _seed = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t nextRandom() {
+    _seed ^= _seed << 13;
+    _seed ^= _seed >> 7;
+    _seed ^= _seed << 17;
+    return _seed;
+}
+
+static bool cpuHasBmi2() {
+#if defined(__GNUC__) && !defined(_MSC_VER)
+    return __builtin_cpu_supports("bmi2");
+#elif defined(__BMI2__)
+    return true;
+#else
+    return false;
+#endif
+}
+
+static bool cpuHasAvx2() {
+#if defined(__GNUC__) && !defined(_MSC_VER)
+    return __builtin_cpu_supports("avx2");
+#elif defined(__AVX2__)
+    return true;
+#else
+    return false;
+#endif
+}
+
+// each loop carries the backend's target attribute so its lookups inline just like they would in the generator
+static uint64_t runMagic(const std::vector<Lookup>& lookups) {
+    uint64_t sum = 0;
+    for (const auto& lookup : lookups) {
+        sum ^= getRookAttacks(lookup.square, lookup.occupancy) ^ getBishopAttacks(lookup.square, lookup.occupancy);
+    }
+    return sum;
+}
+
+SLIDERS_TARGET_BMI2 static uint64_t runPext(const std::vector<Lookup>& lookups) {
+    uint64_t sum = 0;
+    for (const auto& lookup : lookups) {
+        sum ^= getRookAttacksPext(lookup.square, lookup.occupancy) ^ getBishopAttacksPext(lookup.square, lookup.occupancy);
+    }
+    return sum;
+}
+
+SLIDERS_TARGET_AVX2 static uint64_t runKoggeStone(const std::vector<Lookup>& lookups) {
+    uint64_t sum = 0;
+    for (const auto& lookup : lookups) {
+        sum ^= getRookAttacksKoggeStone(lookup.square, lookup.occupancy) ^ getBishopAttacksKoggeStone(lookup.square, lookup.occupancy);
+    }
+    return sum;
+}
+
+static uint64_t runReference(const std::vector<Lookup>& lookups) {
+    uint64_t sum = 0;
+    for (const auto& lookup : lookups) {
+        sum ^= ratt(lookup.square, lookup.occupancy) ^ batt(lookup.square, lookup.occupancy);
+    }
+    return sum;
+}
+
+SLIDERS_TARGET_BMI2 static bool checkPext(const std::vector<Lookup>& lookups) {
+    for (const auto& lookup : lookups) {
+        if (getRookAttacksPext(lookup.square, lookup.occupancy) != ratt(lookup.square, lookup.occupancy) ||
+            getBishopAttacksPext(lookup.square, lookup.occupancy) != batt(lookup.square, lookup.occupancy))
+            return false;
+    }
+    return true;
+}
+
+SLIDERS_TARGET_AVX2 static bool checkKoggeStone(const std::vector<Lookup>& lookups) {
+    for (const auto& lookup : lookups) {
+        if (getRookAttacksKoggeStone(lookup.square, lookup.occupancy) != ratt(lookup.square, lookup.occupancy) ||
+            getBishopAttacksKoggeStone(lookup.square, lookup.occupancy) != batt(lookup.square, lookup.occupancy))
+            return false;
+    }
+    return true;
+}
+
+static bool checkMagic(const std::vector<Lookup>& lookups) {
+    for (const auto& lookup : lookups) {
+        if (getRookAttacks(lookup.square, lookup.occupancy) != ratt(lookup.square, lookup.occupancy) ||
+            getBishopAttacks(lookup.square, lookup.occupancy) != batt(lookup.square, lookup.occupancy))
+            return false;
+    }
+    return true;
+}
+
+static void report(const char* name, uint64_t (*run)(const std::vector<Lookup>&), const std::vector<Lookup>& lookups, int rounds, uint64_t expected) {
+    uint64_t sum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; round++) {
+        sum ^= run(lookups);
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    // a rook and a bishop lookup per entry
+    const double lookupsDone = 2.0 * (double)lookups.size() * rounds;
+    std::printf("%-12s %8.2f ns/lookup %8.1f M lookups/s %s\n", name, elapsed / lookupsDone,
+                lookupsDone * 1000.0 / (double)elapsed, sum == expected ? "ok" : "MISMATCH");
+}
+
+int main(int argc, char** argv) {
+    int count = 65536;
+    int rounds = 200;
+    int density = 2;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--lookups") == 0 && i + 1 < argc) {
+            count = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--rounds") == 0 && i + 1 < argc) {
+            rounds = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--density") == 0 && i + 1 < argc) {
+            density = std::atoi(argv[++i]);
+        } else {
+            std::fprintf(stderr, "usage: sliderbench [--lookups N] [--rounds N] [--density 1-3]\n");
+            return 1;
+        }
+    }
+
+    std::vector<Lookup> lookups(count > 0 ? count : 1);
+    for (auto& lookup : lookups) {
+        lookup.square = (int)(nextRandom() & 63);
+        uint64_t occupancy = nextRandom();
+        for (int i = 1; i < density; i++) {
+            occupancy &= nextRandom();
+        }
+        lookup.occupancy = occupancy;
+    }
+
+    // all backends have to agree with the ray walk before their timings mean anything
+    bool passed = checkMagic(lookups);
+    // the rounds are xor'd together, so an even number of them cancels out
+    const uint64_t expected = (rounds & 1) ? runReference(lookups) : 0;
+
+    std::printf("%zu lookups x %d rounds, generator built with %s\n", lookups.size(), rounds, sliderBackendName());
+    report("magic", runMagic, lookups, rounds, expected);
+    if (cpuHasBmi2()) {
+        passed &= checkPext(lookups);
+        report("pext", runPext, lookups, rounds, expected);
+    } else {
+        std::printf("%-12s skipped, no BMI2\n", "pext");
+    }
+    if (cpuHasAvx2()) {
+        passed &= checkKoggeStone(lookups);
+        report("kogge-stone", runKoggeStone, lookups, rounds, expected);
+    } else {
+        std::printf("%-12s skipped, no AVX2\n", "kogge-stone");
+    }
+
+    if (!passed) {
+        std::printf("attack mismatch against the reference ray walk\n");
+    }
+    return passed ? 0 : 1;
+}
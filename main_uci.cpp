@@ -0,0 +1,303 @@
+//
+// UCI front end for the bitboard search, no GLFW/ImGui, so it runs headless under a match manager or a GUI
+// commands come in on stdin and answers go out on stdout, the search runs on its own thread so
+// stop and ponderhit are heard while it thinks
+//
+// supported: uci, isready, ucinewgame, setoption (Hash, Threads, EvalFile, BookFile, BitbaseFile),
+// position startpos|fen ... [moves ...], go (wtime btime winc binc movestogo movetime depth nodes infinite ponder),
+// stop, ponderhit, quit
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include "classes/ChessAI.h"
+
+static const char* START_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+// kept back from every time budget for the GUI and the pipe
+constexpr int MOVE_OVERHEAD_MS = 30;
+// how many more moves the clock is split over when the GUI doesn't say
+constexpr int DEFAULT_MOVES_TO_GO = 30;
+
+// what a go command asked for, the times in milliseconds
+struct GoCommand {
+    int time[2] = { 0, 0 };
+    int increment[2] = { 0, 0 };
+    int movesToGo = 0;
+    int moveTime = 0;
+    int depth = 0;
+    uint64_t nodes = 0;
+    bool infinite = false;
+    bool ponder = false;
+};
+
+class UciEngine {
+public:
+    UciEngine() {
+        _state.initFEN(START_FEN);
+        _ai.setInfoCallback([this](const SearchInfo& info) { sendInfo(info); });
+    }
+    ~UciEngine() { stopSearch(); }
+
+    void run();
+
+private:
+    void send(const std::string& line);
+    void sendInfo(const SearchInfo& info);
+    void setOption(std::istringstream& input);
+    void setPosition(std::istringstream& input);
+    void go(std::istringstream& input);
+    // the search limits for a clock, split over the moves still to play
+    SearchLimits timeLimits(const GoCommand& command) const;
+    // stops the search and waits for its bestmove to go out
+    void stopSearch();
+    void ponderHit();
+
+    GameState _state;
+    ChessAI _ai;
+    std::mutex _outputMutex;
+
+    std::thread _search;
+    std::atomic<bool> _searching{false};
+    // while pondering or searching infinitely the best move is held back until stop or ponderhit
+    std::mutex _waitMutex;
+    std::condition_variable _waitDone;
+    bool _holdBestMove = false;
+    // the clock for the move being pondered on, started by ponderhit
+    SearchLimits _ponderLimits;
+    std::thread _ponderTimer;
+};
+
+void UciEngine::send(const std::string& line) {
+    std::lock_guard<std::mutex> lock(_outputMutex);
+    std::cout << line << std::endl;
+}
+
+void UciEngine::sendInfo(const SearchInfo& info) {
+    std::ostringstream line;
+    line << "info depth " << info.depth << " score ";
+    if (info.score > MATE_BOUND) {
+        line << "mate " << (MATE_SCORE - info.score + 1) / 2;
+    } else if (info.score < -MATE_BOUND) {
+        line << "mate -" << (MATE_SCORE + info.score) / 2;
+    } else {
+        line << "cp " << info.score;
+    }
+    line << " nodes " << info.nodes << " nps " << info.nps << " time " << info.timeMs
+         << " hashfull " << _ai.transpositionTable().hashfull() << " pv";
+    for (int i = 0; i < info.pvLength; i++) {
+        line << " " << moveToString(info.pv[i]);
+    }
+    send(line.str());
+}
+
+void UciEngine::setOption(std::istringstream& input) {
+    std::string token;
+    std::string name;
+    std::string value;
+    input >> token;
+    // names and values may both have spaces in them
+    while (input >> token && token != "value") {
+        name += (name.empty() ? "" : " ") + token;
+    }
+    std::getline(input >> std::ws, value);
+
+    if (name == "Hash") {
+        _ai.transpositionTable().resize(std::max(1, std::atoi(value.c_str())));
+    } else if (name == "Threads") {
+        _ai.setThreads(std::max(1, std::atoi(value.c_str())));
+    } else if (name == "EvalFile") {
+        if (!value.empty() && value != "<empty>" && !_ai.loadNetwork(value))
+            send("info string can't load network " + value);
+    } else if (name == "BookFile") {
+        if (!value.empty() && value != "<empty>" && !_ai.loadBook(value))
+            send("info string can't load book " + value);
+    } else if (name == "BitbaseFile") {
+        if (!value.empty() && value != "<empty>" && !_ai.loadBitbases(value))
+            send("info string can't load bitbases " + value);
+    } else if (name != "Ponder") {
+        send("info string unknown option " + name);
+    }
+}
+
+void UciEngine::setPosition(std::istringstream& input) {
+    std::string token;
+    input >> token;
+    if (token == "startpos") {
+        _state.initFEN(START_FEN);
+        input >> token;
+    } else if (token == "fen") {
+        std::string fen;
+        while (input >> token && token != "moves") {
+            fen += (fen.empty() ? "" : " ") + token;
+        }
+        _state.initFEN(fen);
+    }
+    if (token != "moves")
+        return;
+    while (input >> token) {
+        MoveList moves;
+        _state.generateAllMoves(moves);
+        auto move = std::find_if(moves.begin(), moves.end(), [&](const BitMove& move) { return moveToString(move) == token; });
+        if (move == moves.end()) {
+            send("info string illegal move " + token);
+            return;
+        }
+        _state.pushMove(*move);
+    }
+}
+
+SearchLimits UciEngine::timeLimits(const GoCommand& command) const {
+    SearchLimits limits;
+    if (command.depth > 0)
+        limits.maxDepth = command.depth;
+    limits.maxNodes = command.nodes;
+    if (command.moveTime > 0) {
+        limits.hardTimeMs = std::max(1, command.moveTime - MOVE_OVERHEAD_MS);
+        limits.softTimeMs = limits.hardTimeMs;
+        return limits;
+    }
+    const int side = (_state.color == WHITE) ? 0 : 1;
+    const int time = command.time[side];
+    if (command.infinite || time <= 0)
+        return limits;
+    // a share of the clock per move with most of the increment, never more than a third of what's left
+    const int movesToGo = command.movesToGo > 0 ? std::min(command.movesToGo, DEFAULT_MOVES_TO_GO) : DEFAULT_MOVES_TO_GO;
+    const int available = std::max(1, time - MOVE_OVERHEAD_MS);
+    limits.softTimeMs = std::max(1, std::min(available / movesToGo + command.increment[side] * 3 / 4, available));
+    limits.hardTimeMs = std::max(1, std::min(limits.softTimeMs * 3, available / 3 + command.increment[side]));
+    limits.softTimeMs = std::min(limits.softTimeMs, limits.hardTimeMs);
+    return limits;
+}
+
+void UciEngine::go(std::istringstream& input) {
+    stopSearch();
+    GoCommand command;
+    std::string token;
+    while (input >> token) {
+        if (token == "wtime") input >> command.time[0];
+        else if (token == "btime") input >> command.time[1];
+        else if (token == "winc") input >> command.increment[0];
+        else if (token == "binc") input >> command.increment[1];
+        else if (token == "movestogo") input >> command.movesToGo;
+        else if (token == "movetime") input >> command.moveTime;
+        else if (token == "depth") input >> command.depth;
+        else if (token == "nodes") input >> command.nodes;
+        else if (token == "infinite") command.infinite = true;
+        else if (token == "ponder") command.ponder = true;
+    }
+
+    // pondering searches without a clock, ponderhit starts the clock the move would have had
+    SearchLimits limits = timeLimits(command);
+    _ponderLimits = limits;
+    if (command.ponder) {
+        limits.softTimeMs = 0;
+        limits.hardTimeMs = 0;
+    }
+    {
+        std::lock_guard<std::mutex> lock(_waitMutex);
+        _holdBestMove = command.infinite || command.ponder;
+    }
+    _searching = true;
+    _ai.prepareSearch();
+    _search = std::thread([this, limits]() {
+        GameState state = _state;
+        const BitMove best = _ai.findBestMove(state, limits);
+        {
+            std::unique_lock<std::mutex> lock(_waitMutex);
+            _waitDone.wait(lock, [this]() { return !_holdBestMove; });
+        }
+        send("bestmove " + (best == BitMove() ? std::string("0000") : moveToString(best)));
+        {
+            std::lock_guard<std::mutex> lock(_waitMutex);
+            _searching = false;
+        }
+        _waitDone.notify_all();
+    });
+}
+
+void UciEngine::ponderHit() {
+    {
+        std::lock_guard<std::mutex> lock(_waitMutex);
+        _holdBestMove = false;
+    }
+    _waitDone.notify_all();
+    if (!_searching || (_ponderLimits.hardTimeMs <= 0 && _ponderLimits.softTimeMs <= 0))
+        return;
+    // the search is already running without a clock, so the move's time is counted from here
+    if (_ponderTimer.joinable())
+        _ponderTimer.join();
+    const int budget = _ponderLimits.softTimeMs > 0 ? _ponderLimits.softTimeMs : _ponderLimits.hardTimeMs;
+    _ponderTimer = std::thread([this, budget]() {
+        std::unique_lock<std::mutex> lock(_waitMutex);
+        if (!_waitDone.wait_for(lock, std::chrono::milliseconds(budget), [this]() { return !_searching; }))
+            _ai.stop();
+    });
+}
+
+void UciEngine::stopSearch() {
+    {
+        std::lock_guard<std::mutex> lock(_waitMutex);
+        _holdBestMove = false;
+    }
+    _waitDone.notify_all();
+    _ai.stop();
+    if (_search.joinable())
+        _search.join();
+    if (_ponderTimer.joinable())
+        _ponderTimer.join();
+}
+
+void UciEngine::run() {
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        std::istringstream input(line);
+        std::string command;
+        input >> command;
+        if (command == "uci") {
+            send("id name chess-base-with-movement");
+            send("id author ezrafrary");
+            send("option name Hash type spin default " + std::to_string(DEFAULT_HASH_MB) + " min 1 max 65536");
+            send("option name Threads type spin default 1 min 1 max 256");
+            send("option name EvalFile type string default <empty>");
+            send("option name BookFile type string default <empty>");
+            send("option name BitbaseFile type string default <empty>");
+            send("option name Ponder type check default false");
+            send("uciok");
+        } else if (command == "isready") {
+            send("readyok");
+        } else if (command == "ucinewgame") {
+            stopSearch();
+            _ai.transpositionTable().clear();
+        } else if (command == "setoption") {
+            stopSearch();
+            setOption(input);
+        } else if (command == "position") {
+            stopSearch();
+            setPosition(input);
+        } else if (command == "go") {
+            go(input);
+        } else if (command == "stop") {
+            stopSearch();
+        } else if (command == "ponderhit") {
+            ponderHit();
+        } else if (command == "quit") {
+            break;
+        }
+    }
+    stopSearch();
+}
+
+int main(int argc, char** argv) {
+    std::ios::sync_with_stdio(false);
+    UciEngine engine;
+    engine.run();
+    return 0;
+}
@@ -0,0 +1,85 @@
+//
+// checks that the attack maps built for a node survive searching its children, run by ctest
+// every node of a two ply tree below positions from a fixed random walk builds its maps, plays each move,
+// builds the child's maps and takes the move back, after which the parent's maps must still be marked built
+// (so inCheck and SEE take the fast path) and equal to maps built from scratch, and inCheck and SEE must
+// answer the same with and without them
+//
+
+#include <cstdio>
+#include <cstdint>
+#include "classes/GameState.h"
+
+static const char* FENS[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r2q1rk1/pP1p2pp/Q4n2/bbp1p3/Np6/1B3NBn/pPPP1PPP/R3K2R b KQ - 0 1",
+};
+
+static int _failures = 0;
+static uint64_t _checked = 0;
+
+static void check(bool ok, const char* what) {
+    if (!ok && _failures++ < 20)
+        std::fprintf(stderr, "FAILED: %s\n", what);
+}
+
+// the same position with its maps thrown away, so inCheck, SEE and computeAttackMaps start from scratch
+static GameState withoutMaps(const GameState& state) {
+    GameState fresh = state;
+    fresh.flags &= ~AttackMapsValid;
+    return fresh;
+}
+
+static bool sameMaps(const GameState& a, const GameState& b) {
+    for (int i = 0; i < e_numBitboards; i++) {
+        if (a._attacks[i].getData() != b._attacks[i].getData())
+            return false;
+    }
+    return a._attackedTwice[0] == b._attackedTwice[0] && a._attackedTwice[1] == b._attackedTwice[1] &&
+           a._attackBitBoard.getData() == b._attackBitBoard.getData();
+}
+
+static void checkNode(GameState& state, int depth) {
+    state.computeAttackMaps();
+    MoveList moves;
+    state.generateAllMoves(moves);
+    for (const BitMove& move : moves) {
+        state.pushMove(move);
+        if (depth > 1)
+            checkNode(state, depth - 1);
+        else
+            state.computeAttackMaps();
+        state.popMove();
+
+        check(state.flags & AttackMapsValid, "the maps are still built after popMove");
+        GameState fresh = withoutMaps(state);
+        fresh.computeAttackMaps();
+        check(sameMaps(state, fresh), "the restored maps match maps built from scratch");
+        GameState slow = withoutMaps(state);
+        check(state.inCheck() == slow.inCheck(), "inCheck with and without the maps");
+        check(state.see(move) == slow.see(move), "see with and without the maps");
+        _checked++;
+    }
+}
+
+int main() {
+    uint64_t random = 0x9E3779B97F4A7C15ULL;
+    for (const char* fen : FENS) {
+        GameState state;
+        state.initFEN(fen);
+        // a few nodes along a random game from each position
+        for (int ply = 0; ply < 24; ply++) {
+            checkNode(state, 2);
+            MoveList moves;
+            state.generateAllMoves(moves);
+            if (moves.empty())
+                break;
+            random = random * 6364136223846793005ULL + 1442695040888963407ULL;
+            state.pushMove(moves[(int)((random >> 33) % (uint64_t)moves.size())]);
+        }
+    }
+    std::printf("%llu moves checked\n", (unsigned long long)_checked);
+    return _failures ? 1 : 0;
+}
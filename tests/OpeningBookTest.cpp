@@ -0,0 +1,179 @@
+//
+// checks for the opening book, run by ctest
+//   OpeningBookTest keys      book keys of positions against keys put together from BookKeys by hand
+//   OpeningBookTest format    move encoding and a book written to disk probed back
+//
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "classes/OpeningBook.h"
+
+static const char* START_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+static int _failures = 0;
+
+static void check(bool ok, const char* what) {
+    if (!ok) {
+        std::fprintf(stderr, "FAILED: %s\n", what);
+        _failures++;
+    }
+}
+
+// plays the moves, given as e2e4 style strings, from the start position
+static bool playMoves(GameState& state, const std::vector<std::string>& moves) {
+    state.initFEN(START_FEN);
+    for (const std::string& text : moves) {
+        MoveList legal;
+        state.generateAllMoves(legal);
+        bool found = false;
+        for (const BitMove& move : legal) {
+            if (moveToString(move) == text) {
+                state.pushMove(move);
+                found = true;
+                break;
+            }
+        }
+        if (!found)
+            return false;
+    }
+    return true;
+}
+
+static uint64_t keyOf(const char* fen) {
+    GameState state;
+    state.initFEN(fen);
+    return OpeningBook::key(state);
+}
+
+static uint64_t keyAfter(const std::vector<std::string>& moves) {
+    GameState state;
+    check(playMoves(state, moves), "the moves are legal");
+    return OpeningBook::key(state);
+}
+
+// keys built from BookKeys by hand, one part of the position at a time
+static int testKeys() {
+    // the start position is its 32 pieces, all four castling rights and white to move
+    uint64_t start = 0;
+    const char* board = "RNBQKBNRPPPPPPPP................................pppppppprnbqkbnr";
+    for (int square = 0; square < 64; square++) {
+        const char* kinds = "pPnNbBrRqQkK";
+        const char* kind = std::strchr(kinds, board[square]);
+        if (board[square] != '.')
+            start ^= BookKeys.random[BookKeyTable::PIECES + 64 * (int)(kind - kinds) + square];
+    }
+    for (int i = 0; i < 4; i++) {
+        start ^= BookKeys.random[BookKeyTable::CASTLING + i];
+    }
+    start ^= BookKeys.random[BookKeyTable::TURN];
+    check(keyOf(START_FEN) == start, "start position");
+
+    // the side to move and each castling right are one key each, in the order KQkq
+    check((keyOf(START_FEN) ^ keyOf("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR b KQkq - 0 1")) == BookKeys.random[BookKeyTable::TURN],
+          "side to move");
+    const char* rights[4] = { "Qkq", "Kkq", "KQq", "KQk" };
+    for (int i = 0; i < 4; i++) {
+        const std::string fen = std::string("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w ") + rights[i] + " - 0 1";
+        check((keyOf(START_FEN) ^ keyOf(fen.c_str())) == BookKeys.random[BookKeyTable::CASTLING + i], "castling right");
+    }
+
+    // the en passant file only counts when a pawn of the side to move stands next to the pawn that moved
+    check(keyAfter({ "e2e4" }) == keyOf("rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1"),
+          "e2e4 has no en passant key");
+    check((keyAfter({ "a2a4", "b7b5", "h2h4", "b5b4", "c2c4" }) ^ keyOf("rnbqkbnr/p1pppppp/8/8/PpP4P/8/1P1PPPP1/RNBQKBNR b KQkq - 0 3"))
+          == BookKeys.random[BookKeyTable::EN_PASSANT + 2], "c2c4 next to the b4 pawn has the c file key");
+    check(keyAfter({ "e2e4", "d7d5", "e4e5", "f7f5" }) == keyOf("rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3"),
+          "f7f5 next to the e5 pawn, moved or from a FEN");
+
+    // the same position reached in a different order is the same key
+    check(keyAfter({ "g1f3", "g8f6", "b1c3" }) == keyAfter({ "b1c3", "g8f6", "g1f3" }), "transposition");
+    return _failures ? 1 : 0;
+}
+
+static void writeBig(FILE* file, uint64_t value, int bytes) {
+    unsigned char data[8];
+    for (int i = 0; i < bytes; i++) {
+        data[i] = (unsigned char)(value >> (8 * (bytes - 1 - i)));
+    }
+    std::fwrite(data, 1, bytes, file);
+}
+
+static int testFormat() {
+    GameState state;
+    state.initFEN("r3k2r/8/8/8/8/8/1p6/R3K2R b KQkq - 0 1");
+    MoveList moves;
+    state.generateAllMoves(moves);
+    bool castles = false;
+    for (const BitMove& move : moves) {
+        // castling is the king taking its own rook, promotions count knight 1 to queen 4
+        if (move.type() == KingCastle)
+            check(OpeningBook::encodeMove(move) == ((60 << 6) | 63), "e8g8 is written as e8h8");
+        else if (move.type() == QueenCastle)
+            check(OpeningBook::encodeMove(move) == ((60 << 6) | 56), "e8c8 is written as e8a8");
+        else if (moveToString(move) == "b2b1q")
+            check(OpeningBook::encodeMove(move) == ((4 << 12) | (9 << 6) | 1), "b2b1q has promotion 4");
+        castles |= move.isCastle();
+    }
+    check(castles, "black can castle");
+
+    // a book with two moves for the start position and one for a position that isn't reached
+    state.initFEN(START_FEN);
+    const uint64_t start = OpeningBook::key(state);
+    MoveList startMoves;
+    state.generateAllMoves(startMoves);
+    BitMove e2e4;
+    BitMove d2d4;
+    for (const BitMove& move : startMoves) {
+        if (moveToString(move) == "e2e4") e2e4 = move;
+        if (moveToString(move) == "d2d4") d2d4 = move;
+    }
+    const std::string path = "OpeningBookTest.bin";
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        check(false, "can't write the test book");
+        return 1;
+    }
+    struct Entry {
+        uint64_t key;
+        uint16_t move;
+        uint16_t weight;
+    };
+    Entry entries[] = {
+        { start, OpeningBook::encodeMove(e2e4), 3 },
+        { start, OpeningBook::encodeMove(d2d4), 1 },
+        { start + 1, OpeningBook::encodeMove(e2e4), 5 },
+    };
+    for (const Entry& entry : entries) {
+        writeBig(file, entry.key, 8);
+        writeBig(file, entry.move, 2);
+        writeBig(file, entry.weight, 2);
+        writeBig(file, 0, 4);
+    }
+    std::fclose(file);
+
+    OpeningBook book;
+    check(book.load(path), "the test book loads");
+    check(book.entryCount() == 3, "the test book has 3 entries");
+    // the random value picks by weight: 0-2 fall on e2e4 and 3 on d2d4
+    check(book.probe(state, 0) == e2e4, "random 0 picks e2e4");
+    check(book.probe(state, 2) == e2e4, "random 2 picks e2e4");
+    check(book.probe(state, 3) == d2d4, "random 3 picks d2d4");
+    check(book.probe(state, 7) == d2d4, "random 7 picks d2d4");
+    state.pushMove(e2e4);
+    check(book.probe(state, 0) == BitMove(), "out of book after e2e4");
+    book.unload();
+    std::remove(path.c_str());
+    return _failures ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+    const char* test = argc > 1 ? argv[1] : "";
+    if (std::strcmp(test, "keys") == 0)
+        return testKeys();
+    if (std::strcmp(test, "format") == 0)
+        return testFormat();
+    std::fprintf(stderr, "usage: OpeningBookTest keys|format\n");
+    return 2;
+}